@@ -0,0 +1,94 @@
+#include "alloc_hook.hpp"
+
+#ifdef ALLOC_HOOK
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+
+using namespace std;
+
+// glibc's own entry points; defining malloc and friends in the executable
+// interposes them for every library, OpenCV and libstdc++'s operator new included
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* p, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+}
+
+// Plain TLS with no constructor, so counting works from the first allocation a
+// thread makes
+static thread_local uint64_t threadCount = 0;
+static atomic<uint64_t> processCount{0};
+
+static void countAllocation() {
+    threadCount++;
+    processCount.fetch_add(1, memory_order_relaxed);
+}
+
+extern "C" {
+
+void* malloc(size_t size) {
+    countAllocation();
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    countAllocation();
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* p, size_t size) {
+    countAllocation();
+    return __libc_realloc(p, size);
+}
+
+void* memalign(size_t alignment, size_t size) {
+    countAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    countAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** out, size_t alignment, size_t size) {
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) return EINVAL;
+    countAllocation();
+    void* p = __libc_memalign(alignment, size);
+    if (!p) return ENOMEM;
+    *out = p;
+    return 0;
+}
+
+}
+
+bool allocationHookEnabled() {
+    return true;
+}
+
+uint64_t threadAllocations() {
+    return threadCount;
+}
+
+uint64_t processAllocations() {
+    return processCount.load(memory_order_relaxed);
+}
+
+#else
+
+bool allocationHookEnabled() {
+    return false;
+}
+
+uint64_t threadAllocations() {
+    return 0;
+}
+
+uint64_t processAllocations() {
+    return 0;
+}
+
+#endif
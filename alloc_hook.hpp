@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+
+// Heap allocation counting for checking that the steady-state frame path does
+// not allocate. Builds made with "make ALLOC_HOOK=1" interpose glibc's malloc
+// family, so every heap allocation is counted: operator new, OpenCV's buffers
+// and C code alike. In other builds the hook is absent and every count reads 0.
+bool allocationHookEnabled();
+
+// Heap allocations made so far by the calling thread
+uint64_t threadAllocations();
+
+// Heap allocations made so far by the whole process
+uint64_t processAllocations();
@@ -0,0 +1,158 @@
+// Compares the detector backends on a labelled image set.
+//
+// Every image is scaled to the 640x480 working size and run through each
+// backend with the live full-quality settings. The table shows the median
+// latency per image, throughput one image at a time and in batches of
+// BATCH_SIZE, and recall and precision against the labels: a detection counts
+// when it overlaps an unmatched labelled face with IoU >= 0.5.
+//
+// Usage: backend_bench LABELLED_DIR [DNN_MODEL [DNN_CONFIG]]
+// LABELLED_DIR holds the images and a labels.txt with one line per image:
+//   image.jpg x y w h [x y w h ...]
+// in that image's pixels. Images without faces are listed with no boxes.
+// Backends whose model files are missing are skipped.
+
+#include "../face_detector.hpp"
+#include "../face_tracker.hpp"
+#include "bench_util.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+static const Size WORKING_SIZE(640, 480);
+static const DetectionParams PARAMS; // The live defaults
+static const double MATCH_IOU = 0.5;
+static const size_t BATCH_SIZE = 8;
+
+struct LabelledImage {
+    Mat gray;
+    vector<Rect> faces;
+};
+
+static vector<LabelledImage> loadLabelled(const string& dir) {
+    vector<LabelledImage> images;
+    ifstream labels(dir + "/labels.txt");
+    string line;
+    while (getline(labels, line)) {
+        istringstream ss(line);
+        string file;
+        if (!(ss >> file) || file[0] == '#') continue;
+        Mat image = imread(dir + "/" + file, IMREAD_GRAYSCALE);
+        if (image.empty()) {
+            cerr << "Skipping unreadable image: " << file << endl;
+            continue;
+        }
+
+        LabelledImage labelled;
+        resize(image, labelled.gray, WORKING_SIZE);
+        double sx = static_cast<double>(WORKING_SIZE.width) / image.cols;
+        double sy = static_cast<double>(WORKING_SIZE.height) / image.rows;
+        int x, y, w, h;
+        while (ss >> x >> y >> w >> h) {
+            labelled.faces.emplace_back(cvRound(x * sx), cvRound(y * sy), cvRound(w * sx), cvRound(h * sy));
+        }
+        images.push_back(std::move(labelled));
+    }
+    return images;
+}
+
+// Greedy one-to-one matching at MATCH_IOU
+static int countMatches(const vector<Rect>& truth, const vector<Rect>& found) {
+    vector<bool> used(truth.size(), false);
+    int matches = 0;
+    for (const Rect& face : found) {
+        for (size_t i = 0; i < truth.size(); i++) {
+            double inter = (face & truth[i]).area();
+            double iou = inter / (face.area() + truth[i].area() - inter);
+            if (!used[i] && iou >= MATCH_IOU) {
+                used[i] = true;
+                matches++;
+                break;
+            }
+        }
+    }
+    return matches;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        cout << "backend_bench: no labelled set given (make bench BENCH_LABELS=dir), skipping" << endl;
+        return 0;
+    }
+    vector<LabelledImage> images = loadLabelled(argv[1]);
+    if (images.empty()) {
+        cerr << "No labelled images in " << argv[1] << endl;
+        return 1;
+    }
+
+    // Single-threaded, so the backends compare on equal terms
+    setNumThreads(1);
+
+    vector<DetectorConfig> configs(3);
+    configs[0].backend = DetectorBackend::Haar;
+    configs[1].backend = DetectorBackend::Lbp;
+    configs[2].backend = DetectorBackend::Dnn;
+    if (argc > 2) configs[2].modelPath = argv[2];
+    if (argc > 3) configs[2].configPath = argv[3];
+
+    size_t labelled = 0;
+    for (const auto& image : images) labelled += image.faces.size();
+    cout << images.size() << " images, " << labelled << " labelled faces, at "
+         << WORKING_SIZE.width << "x" << WORKING_SIZE.height << endl;
+    cout << left << setw(8) << "BACKEND" << right << setw(12) << "ms/IMAGE" << setw(12) << "IMAGES/s"
+         << setw(12) << "BATCHED/s" << setw(10) << "RECALL" << setw(11) << "PRECISION" << endl;
+
+    for (const auto& config : configs) {
+        auto detector = createFaceDetector(config);
+        if (!detector) {
+            cout << left << setw(8) << detectorBackendName(config.backend) << right << setw(12) << "skipped" << endl;
+            continue;
+        }
+
+        vector<double> latencies;
+        int found = 0, matched = 0;
+        auto start = chrono::steady_clock::now();
+        for (const auto& image : images) {
+            vector<Rect> faces;
+            auto t0 = chrono::steady_clock::now();
+            detector->detectMultiScale(image.gray, faces, PARAMS.scaleFactor, PARAMS.minNeighbors, PARAMS.minSize,
+                                       PARAMS.maxSize);
+            latencies.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count());
+            found += static_cast<int>(faces.size());
+            matched += countMatches(image.faces, faces);
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        auto batchStart = chrono::steady_clock::now();
+        for (size_t first = 0; first < images.size(); first += BATCH_SIZE) {
+            vector<DetectionJob> jobs;
+            for (size_t i = first; i < min(images.size(), first + BATCH_SIZE); i++) {
+                DetectionJob job;
+                job.gray = images[i].gray;
+                job.minSize = PARAMS.minSize;
+                job.maxSize = PARAMS.maxSize;
+                jobs.push_back(job);
+            }
+            detector->detectBatch(jobs, PARAMS.scaleFactor, PARAMS.minNeighbors);
+        }
+        double batchSeconds = chrono::duration<double>(chrono::steady_clock::now() - batchStart).count();
+
+        double recall = labelled ? static_cast<double>(matched) / labelled : 1.0;
+        double precision = found ? static_cast<double>(matched) / found : 1.0;
+        cout << left << setw(8) << detectorBackendName(config.backend) << right << fixed << setprecision(2)
+             << setw(12) << percentile(latencies, 50) << setprecision(1)
+             << setw(12) << images.size() / seconds << setw(12) << images.size() / batchSeconds
+             << setprecision(3) << setw(10) << recall << setw(11) << precision << endl;
+    }
+    return 0;
+}
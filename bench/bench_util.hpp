@@ -0,0 +1,59 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+// Timing and input helpers shared by the microbenchmarks
+
+// Wall time of each of `iterations` calls to body(i), in Unit: std::nano,
+// std::micro or std::milli
+template <typename Unit, typename F>
+std::vector<double> timeCalls(int iterations, F&& body) {
+    std::vector<double> samples;
+    samples.reserve(iterations);
+    for (int i = 0; i < iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        body(i);
+        samples.push_back(std::chrono::duration<double, Unit>(std::chrono::steady_clock::now() - start).count());
+    }
+    return samples;
+}
+
+// The sample at or just above the given percentile; 50 is the median
+inline double percentile(std::vector<double> samples, int percent) {
+    size_t rank = std::min(samples.size() - 1, samples.size() * percent / 100);
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return samples[rank];
+}
+
+// Median wall time of one call to body(i), in Unit
+template <typename Unit, typename F>
+double medianTime(int iterations, F&& body) {
+    return percentile(timeCalls<Unit>(iterations, body), 50);
+}
+
+// 640x480 noise with a few face-sized blobs, so the cascade has work at every
+// scale. The same count and type always give the same frames.
+inline std::vector<cv::Mat> syntheticFaceFrames(int count, int type) {
+    std::vector<cv::Mat> frames;
+    cv::RNG rng(12345);
+    for (int i = 0; i < count; i++) {
+        cv::Mat frame(480, 640, type);
+        cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(256));
+        cv::GaussianBlur(frame, frame, cv::Size(5, 5), 0);
+        for (int j = 0; j < 4; j++) {
+            cv::Point center(rng.uniform(60, 580), rng.uniform(60, 420));
+            int radius = rng.uniform(20, 120);
+            cv::ellipse(frame, center, cv::Size(radius, radius * 5 / 4), 0, 0, 360,
+                        cv::Scalar::all(rng.uniform(120, 220)), cv::FILLED);
+            cv::circle(frame, center + cv::Point(-radius / 3, -radius / 4), radius / 8, cv::Scalar::all(30),
+                       cv::FILLED);
+            cv::circle(frame, center + cv::Point(radius / 3, -radius / 4), radius / 8, cv::Scalar::all(30),
+                       cv::FILLED);
+        }
+        frames.push_back(frame);
+    }
+    return frames;
+}
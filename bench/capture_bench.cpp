@@ -0,0 +1,89 @@
+// Per-frame cost of getting a camera frame ready for display and detection.
+//
+// "before" is the old path: YUV decoded to BGR, copied by the same-size
+// resize, then converted back to gray. "after" decodes to BGR for display only
+// and hands the source's own luma to the detector: the NV12 Y plane in place,
+// the YUYV one in a single extraction pass. Both run on the raw file source,
+// which maps frames the same way camera buffers are mapped. MB/FRAME counts
+// the bytes each path reads and writes.
+
+#include "../frame_source.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace std;
+using namespace cv;
+
+static const int FRAMES = 120;
+static const Size FRAME_SIZE(640, 480);
+
+static string writeRawFile(const string& format) {
+    string path = "/tmp/capture_bench_" + to_string(FRAME_SIZE.width) + "x" + to_string(FRAME_SIZE.height) + "." + format;
+    size_t frameBytes = format == "nv12" ? FRAME_SIZE.area() * 3 / 2 : FRAME_SIZE.area() * 2;
+    Mat noise(1, static_cast<int>(frameBytes), CV_8UC1);
+    RNG rng(7);
+    ofstream out(path, ios::binary | ios::trunc);
+    for (int i = 0; i < FRAMES; i++) {
+        rng.fill(noise, RNG::UNIFORM, 16, 236);
+        out.write(reinterpret_cast<const char*>(noise.data), frameBytes);
+    }
+    return path;
+}
+
+// Milliseconds per frame over the whole file
+template <typename F>
+static double timeFile(const string& path, F&& perFrame) {
+    auto source = openInputSource(path);
+    if (!source) return -1.0;
+    auto start = chrono::steady_clock::now();
+    int frames = 0;
+    while (perFrame(*source)) frames++;
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / max(1, frames);
+}
+
+int main() {
+    double pixels = FRAME_SIZE.area();
+
+    cout << left << setw(8) << "FORMAT" << right << setw(14) << "before ms" << setw(14) << "after ms"
+         << setw(16) << "before MB" << setw(14) << "after MB" << setw(14) << "LUMA DIFF" << endl;
+    for (string format : {"nv12", "yuyv"}) {
+        string path = writeRawFile(format);
+        double yuvBytes = format == "nv12" ? 1.5 : 2.0;
+
+        Mat frame, copied, gray;
+        double beforeMs = timeFile(path, [&](FrameSource& source) {
+            if (!source.read(frame)) return false;
+            resize(frame, copied, FRAME_SIZE); // Same size: a full copy
+            cvtColor(copied, gray, COLOR_BGR2GRAY);
+            return true;
+        });
+
+        LumaPlane luma;
+        double lumaDiff = 0;
+        double afterMs = timeFile(path, [&](FrameSource& source) {
+            if (!source.readWithLuma(frame, luma)) return false;
+            cvtColor(frame, gray, COLOR_BGR2GRAY);
+            lumaDiff = norm(luma.gray, gray, NORM_L1) / pixels;
+            return true;
+        });
+        // The comparison above is not part of the after path; time it again without it
+        afterMs = timeFile(path, [&](FrameSource& source) { return source.readWithLuma(frame, luma); });
+
+        // Decode reads YUV and writes BGR; the copy moves BGR twice; gray reads BGR and writes luma
+        double decodeBytes = (yuvBytes + 3) * pixels;
+        double beforeBytes = decodeBytes + 6 * pixels + 4 * pixels;
+        double afterBytes = decodeBytes + (format == "nv12" ? 0.0 : 3 * pixels);
+        cout << left << setw(8) << format << right << fixed << setprecision(3) << setw(14) << beforeMs
+             << setw(14) << afterMs << setprecision(2) << setw(16) << beforeBytes / 1e6 << setw(14)
+             << afterBytes / 1e6 << setprecision(2) << setw(14) << lumaDiff << endl;
+        remove(path.c_str());
+    }
+    cout << "LUMA DIFF is the mean absolute difference between native luma and gray converted from BGR" << endl;
+    return 0;
+}
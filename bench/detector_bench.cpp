@@ -0,0 +1,126 @@
+// Parity check and latency benchmark for the parallel pyramid detector.
+//
+// Every frame is run through the stock CascadeClassifier::detectMultiScale and
+// through CascadeDetector at several thread counts. The face lists must match
+// exactly; the table shows the median latency of each.
+//
+// Usage: detector_bench [IMAGE_DIR]
+// Without a directory, synthetic 640x480 frames are used.
+
+#include "../face_detector.hpp"
+#include "../face_tracker.hpp"
+#include "../frame_source.hpp"
+#include "bench_util.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+static const int ITERATIONS = 20;
+static const int MAX_FRAMES = 50;
+static const int SYNTHETIC_FRAMES = 8;
+
+// The live defaults, i.e. a full-quality detection pass
+static const DetectionParams PARAMS;
+
+static vector<Mat> loadFrames(int argc, char** argv) {
+    vector<Mat> frames;
+    if (argc > 1) {
+        auto source = openInputSource(argv[1]);
+        if (!source) return frames;
+        Mat frame;
+        while (static_cast<int>(frames.size()) < MAX_FRAMES && source->read(frame)) {
+            Mat gray;
+            cvtColor(frame, gray, COLOR_BGR2GRAY);
+            frames.push_back(gray);
+        }
+        return frames;
+    }
+
+    return syntheticFaceFrames(SYNTHETIC_FRAMES, CV_8UC1);
+}
+
+static bool sameFaces(vector<Rect> a, vector<Rect> b) {
+    auto byPosition = [](const Rect& l, const Rect& r) {
+        return tie(l.x, l.y, l.width, l.height) < tie(r.x, r.y, r.width, r.height);
+    };
+    sort(a.begin(), a.end(), byPosition);
+    sort(b.begin(), b.end(), byPosition);
+    return a == b;
+}
+
+int main(int argc, char** argv) {
+    vector<Mat> frames = loadFrames(argc, argv);
+    if (frames.empty()) {
+        cerr << "No frames to benchmark" << endl;
+        return 1;
+    }
+
+    CascadeClassifier stock;
+    if (!stock.load(HAAR_CASCADE_PATH)) {
+        cerr << "Error loading Haar cascade file!" << endl;
+        return 1;
+    }
+
+    // Keep OpenCV's own parallel_for out of the comparison
+    setNumThreads(1);
+
+    vector<vector<Rect>> expected(frames.size());
+    double stockMs = 0.0;
+    for (size_t i = 0; i < frames.size(); i++) {
+        stockMs += medianTime<milli>(ITERATIONS, [&](int) {
+            stock.detectMultiScale(frames[i], expected[i], PARAMS.scaleFactor, PARAMS.minNeighbors, 0,
+                                   PARAMS.minSize, PARAMS.maxSize);
+        });
+    }
+    stockMs /= frames.size();
+
+    int cores = static_cast<int>(max(1u, thread::hardware_concurrency()));
+    vector<int> threadCounts = {1, 2, 4};
+    if (cores > 4) threadCounts.push_back(cores);
+
+    cout << frames.size() << " frames, " << frames[0].cols << "x" << frames[0].rows << endl;
+    cout << left << setw(12) << "DETECTOR" << right << setw(10) << "THREADS"
+         << setw(12) << "ms/FRAME" << setw(10) << "SPEEDUP" << setw(8) << "MATCH" << endl;
+    cout << left << setw(12) << "stock" << right << setw(10) << 1
+         << fixed << setprecision(2) << setw(12) << stockMs << setw(9) << 1.0 << "x" << setw(8) << "-" << endl;
+
+    bool allMatch = true;
+    for (int threads : threadCounts) {
+        CascadeDetector detector(threads);
+        if (!detector.load(HAAR_CASCADE_PATH)) {
+            cerr << "Error loading Haar cascade file!" << endl;
+            return 1;
+        }
+
+        bool match = true;
+        double totalMs = 0.0;
+        for (size_t i = 0; i < frames.size(); i++) {
+            vector<Rect> faces;
+            totalMs += medianTime<milli>(ITERATIONS, [&](int) {
+                detector.detectMultiScale(frames[i], faces, PARAMS.scaleFactor, PARAMS.minNeighbors, PARAMS.minSize,
+                                          PARAMS.maxSize);
+            });
+            if (!sameFaces(faces, expected[i])) {
+                match = false;
+                cerr << "Mismatch on frame " << i << " with " << threads << " threads: "
+                     << faces.size() << " faces vs " << expected[i].size() << endl;
+            }
+        }
+        allMatch = allMatch && match;
+
+        double meanMs = totalMs / frames.size();
+        cout << left << setw(12) << "pyramid" << right << setw(10) << threads
+             << fixed << setprecision(2) << setw(12) << meanMs
+             << setw(9) << stockMs / meanMs << "x" << setw(8) << (match ? "yes" : "NO") << endl;
+    }
+
+    return allMatch ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+// Frame buffers from the heap versus the frame pool.
+//
+// Replays the capture stage's buffer traffic: every frame is decoded into a
+// buffer handed over to the next stages, shared by a detection and a render
+// slot, and released a few frames later, as the queues would. "resize" adds the
+// scaled copy made for inputs that are not at the working size. Build with
+// "make ALLOC_HOOK=1 bench" to also count heap allocations per frame; the pool
+// must then reach zero after warmup, or the benchmark fails.
+
+#include "../alloc_hook.hpp"
+#include "../frame_pool.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace std;
+using namespace cv;
+
+static const int FRAMES = 2000;
+static const int WARMUP_FRAMES = 50;
+static const int HELD_FRAMES = 4; // Frames in flight across the queues
+
+struct Result {
+    double usPerFrame = 0.0;
+    double allocationsPerFrame = 0.0;
+};
+
+static Result replay(const Mat& source, bool pooled, bool scale) {
+    Mat frame, scaled;
+    if (pooled) attachFramePool(frame);
+    Mat detectSlots[HELD_FRAMES], renderSlots[HELD_FRAMES];
+
+    uint64_t allocations = 0;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < WARMUP_FRAMES + FRAMES; i++) {
+        if (i == WARMUP_FRAMES) {
+            allocations = threadAllocations();
+            start = chrono::steady_clock::now();
+        }
+        source.copyTo(frame); // Stands in for the decode into the capture buffer
+        Mat packet;
+        if (scale) {
+            if (pooled) attachFramePool(packet);
+            resize(frame, packet, Size(640, 480));
+        } else {
+            packet = std::move(frame);
+            if (pooled) attachFramePool(frame);
+        }
+        detectSlots[i % HELD_FRAMES] = packet; // Shared, not copied
+        renderSlots[(i + 1) % HELD_FRAMES] = packet;
+    }
+    Result result;
+    result.usPerFrame = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / FRAMES;
+    result.allocationsPerFrame = static_cast<double>(threadAllocations() - allocations) / FRAMES;
+    return result;
+}
+
+int main() {
+    // OpenCV's worker pool allocates per parallel call; keep to the buffers
+    setNumThreads(1);
+    bool failed = false;
+    cout << left << setw(16) << "PATH" << setw(8) << "BUFFERS" << right << setw(12) << "us/FRAME";
+    if (allocationHookEnabled()) cout << setw(14) << "ALLOCS/FRAME";
+    cout << endl;
+
+    for (bool scale : {false, true}) {
+        Mat source(scale ? Size(1280, 720) : Size(640, 480), CV_8UC3);
+        randu(source, Scalar::all(0), Scalar::all(255));
+        for (bool pooled : {false, true}) {
+            Result result = replay(source, pooled, scale);
+            cout << left << setw(16) << (scale ? "resize" : "hand-over") << setw(8) << (pooled ? "pool" : "heap")
+                 << right << fixed << setprecision(1) << setw(12) << result.usPerFrame;
+            if (allocationHookEnabled()) cout << setprecision(2) << setw(14) << result.allocationsPerFrame;
+            cout << endl;
+            if (pooled && allocationHookEnabled() && result.allocationsPerFrame > 0) failed = true;
+        }
+    }
+
+    FramePool::Stats stats = framePool().stats();
+    cout << "pool: " << stats.buffers << " buffers, " << stats.bytes / 1024 << " KB, " << stats.reuses
+         << " reuses, " << stats.fallbacks << " fallbacks" << endl;
+    if (failed) cerr << "frame pool path allocated in steady state" << endl;
+    return failed ? 1 : 0;
+}
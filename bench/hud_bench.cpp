@@ -0,0 +1,145 @@
+// Before/after microbenchmark for HUD text.
+//
+// "before" draws the render loop's text the way it used to: a putText per
+// line on every frame, the log panel anti-aliased. "after" keeps the same
+// lines in a HudLayer and composes it, for three update patterns: nothing
+// changed since the last frame (most frames), one line changed (the FPS or a
+// stats line ticking over) and every line changed (the worst case, e.g. a
+// burst of logs while the stats refresh).
+
+#include "../hud_layer.hpp"
+#include "bench_util.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+static const int ITERATIONS = 500;
+
+struct HudLine {
+    Point origin;
+    HudLayer::Font font;
+    Scalar color;
+    string text;
+};
+
+// What a 640x480 frame carries in monitoring mode with stage latencies shown
+static vector<HudLine> buildHud(int variant) {
+    HudLayer::Font stats{FONT_HERSHEY_SIMPLEX, 0.4, 1, LINE_8};
+    HudLayer::Font stage{FONT_HERSHEY_PLAIN, 0.8, 1, LINE_8};
+    HudLayer::Font logHeader{FONT_HERSHEY_PLAIN, 0.7, 1, LINE_AA};
+    HudLayer::Font log{FONT_HERSHEY_PLAIN, 0.6, 1, LINE_AA};
+    Scalar white(255, 255, 255);
+    char text[96];
+
+    vector<HudLine> lines;
+    snprintf(text, sizeof(text), "FPS: %.1f", 23.9 + variant * 0.1);
+    lines.push_back({Point(10, 20), stats, white, text});
+    snprintf(text, sizeof(text), "CPU: %.2f%% PEAK: %.0f%%", 31.25 + variant, 78.0);
+    lines.push_back({Point(10, 35), stats, white, text});
+    lines.push_back({Point(10, 50), stats, white, "RAM: 42.17%"});
+    lines.push_back({Point(10, 65), stats, white, "STO: 63.02%"});
+    lines.push_back({Point(10, 80), stats, white, "NET: Connected 12 ms"});
+    snprintf(text, sizeof(text), "2024-05-01 08:00:%02d", variant % 60);
+    lines.push_back({Point(480, 35), stats, white, text});
+    snprintf(text, sizeof(text), "DETQ: %d/2 DROP: %d", variant % 3, 17 + variant);
+    lines.push_back({Point(10, 95), stats, white, text});
+    lines.push_back({Point(10, 110), stats, white, "RENQ: 0/2 DROP: 3"});
+    lines.push_back({Point(10, 125), stats, white, "DET 1/3 x0.75 s1.10 9.8ms"});
+    lines.push_back({Point(10, 140), stats, white, "PROC: 87% 143MB"});
+    lines.push_back({Point(10, 155), stats, white, "HOT: detect0 61%"});
+    for (int i = 0; i < 6; i++) {
+        snprintf(text, sizeof(text), "%-15s%.2f/%.2f/%.2fms", "stage", 1.5 + i, 2.5 + i, 3.5 + i + variant);
+        lines.push_back({Point(10, 175 + 13 * i), stage, white, text});
+    }
+    lines.push_back({Point(427, 299), logHeader, Scalar(50, 230, 50), "[ LOG ]"});
+    for (int i = 0; i < 8; i++) {
+        snprintf(text, sizeof(text), "[08:00:%02d.%03d] Processing unit online", (variant + i) % 60, 100 * i);
+        lines.push_back({Point(427, 324 + 18 * i), log, Scalar(50, 230, 50), text});
+    }
+    return lines;
+}
+
+static void drawDirect(Mat& frame, const vector<HudLine>& lines) {
+    for (const HudLine& line : lines) {
+        putText(frame, line.text, line.origin, line.font.face, line.font.scale, line.color, line.font.thickness,
+                line.font.lineType);
+    }
+}
+
+static void updateLayer(HudLayer& hud, const vector<HudLine>& lines) {
+    for (size_t i = 0; i < lines.size(); i++) {
+        hud.setText(i, lines[i].origin, lines[i].font, lines[i].color, lines[i].text.c_str());
+    }
+}
+
+int main() {
+    Mat background(480, 640, CV_8UC3);
+    randu(background, Scalar::all(0), Scalar::all(256));
+    Mat frame = background.clone();
+
+    // Two alternating HUD states, so "changed" frames really differ
+    vector<HudLine> hud[2] = {buildHud(0), buildHud(1)};
+    vector<HudLine> oneChanged = hud[0];
+    oneChanged[0] = hud[1][0];
+
+    double directUs = medianTime<micro>(ITERATIONS, [&](int i) { drawDirect(frame, hud[i & 1]); });
+
+    HudLayer layer;
+    updateLayer(layer, hud[0]);
+    uint64_t rasters = layer.rasterCount();
+    double staticUs = medianTime<micro>(ITERATIONS, [&](int) {
+        updateLayer(layer, hud[0]);
+        layer.compose(frame);
+    });
+    uint64_t staticRasters = layer.rasterCount() - rasters;
+
+    double oneUs = medianTime<micro>(ITERATIONS, [&](int i) {
+        updateLayer(layer, (i & 1) ? oneChanged : hud[0]);
+        layer.compose(frame);
+    });
+    double allUs = medianTime<micro>(ITERATIONS, [&](int i) {
+        updateLayer(layer, hud[i & 1]);
+        layer.compose(frame);
+    });
+
+    cout << hud[0].size() << " HUD lines on 640x480" << endl
+         << left << setw(24) << "MODE" << right << setw(12) << "us/frame" << setw(10) << "SPEEDUP" << endl;
+    auto row = [&](const char* mode, double us) {
+        cout << left << setw(24) << mode << right << fixed << setprecision(1) << setw(12) << us
+             << setw(9) << directUs / us << "x" << endl;
+    };
+    row("putText every frame", directUs);
+    row("layer, unchanged", staticUs);
+    row("layer, one line changed", oneUs);
+    row("layer, all changed", allUs);
+
+    // Aliased text must come out exactly as putText draws it. Anti-aliased text
+    // is blended from coverage where putText blends stroke by stroke, so it
+    // only has to come close; the difference is reported, not checked.
+    bool ok = staticRasters == 0;
+    if (!ok) cerr << "Unchanged frames rasterised " << staticRasters << " elements" << endl;
+    for (int lineType : {LINE_8, LINE_AA}) {
+        vector<HudLine> lines;
+        for (const HudLine& line : hud[0]) {
+            if (line.font.lineType == lineType) lines.push_back(line);
+        }
+        Mat direct = background.clone();
+        Mat layered = background.clone();
+        drawDirect(direct, lines);
+        HudLayer check;
+        updateLayer(check, lines);
+        check.compose(layered);
+        double diff = norm(direct, layered, NORM_INF);
+        cout << (lineType == LINE_AA ? "Anti-aliased" : "Aliased") << " max difference from putText: " << diff
+             << endl;
+        if (lineType == LINE_8 && diff != 0) ok = false;
+    }
+    return ok ? 0 : 1;
+}
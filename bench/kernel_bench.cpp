@@ -0,0 +1,398 @@
+// Regression suite for the per-frame kernels, with a JSON report.
+//
+// Times the functions the live pipeline calls on every frame: the tint pass,
+// the log panel, the whole HUD, the track distance metric, log submission from
+// several threads at once and a full-frame detection pass with the default
+// parameters. Synthetic frames are always used; --images adds frames from a
+// directory or video, resized to each resolution. Each kernel reports the
+// median and 95th percentile time of one call.
+//
+// With --baseline, the run is compared against an earlier report and the exit
+// status is 1 if any kernel's median got slower by more than the tolerance.
+//
+// Usage: kernel_bench [--images DIR] [--out FILE] [--baseline FILE]
+//                     [--tolerance FRACTION] [--no-detect]
+
+#include "../face_detector.hpp"
+#include "../face_tracker.hpp"
+#include "../frame_source.hpp"
+#include "../hud_render.hpp"
+#include "../kernel_log.hpp"
+#include "../tint.hpp"
+#include "bench_util.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+static const int SAMPLES = 200;
+static const int DETECT_SAMPLES = 20;
+static const int MAX_FRAMES = 20;
+static const int SYNTHETIC_FRAMES = 4;
+static const int RECT_PAIRS = 1024;
+static const int LOG_CALLS = 64; // addKernelLog calls per sample
+static const double DEFAULT_TOLERANCE = 0.10;
+static const Size RESOLUTIONS[] = {Size(640, 480), Size(1280, 720), Size(1920, 1080)};
+static const Size WORKING_SIZE(640, 480); // What every stream is resized to before detection
+
+struct Result {
+    string name;
+    double medianNs = 0.0;
+    double p95Ns = 0.0;
+    int samples = 0;
+    int calls = 0; // Per sample
+};
+
+struct FrameSet {
+    string name;
+    vector<Mat> frames; // BGR, at their original size
+};
+
+static string sizeName(Size size) {
+    return to_string(size.width) + "x" + to_string(size.height);
+}
+
+static Result summarize(string name, vector<double> perCallNs, int calls) {
+    Result result;
+    result.name = move(name);
+    result.samples = static_cast<int>(perCallNs.size());
+    result.calls = calls;
+    result.medianNs = percentile(perCallNs, 50);
+    result.p95Ns = percentile(perCallNs, 95);
+    return result;
+}
+
+// Time per call of `samples` runs of `calls` calls to body(i), in ns
+template <typename F>
+static vector<double> timeRuns(int samples, int calls, F&& body) {
+    vector<double> perCallNs = timeCalls<nano>(samples, [&](int s) {
+        for (int c = 0; c < calls; c++) body(s * calls + c);
+    });
+    for (double& ns : perCallNs) ns /= calls;
+    return perCallNs;
+}
+
+// Times `samples` runs of `calls` calls to body(i), i counting up across runs
+template <typename F>
+static Result measure(string name, int samples, int calls, F&& body) {
+    body(0); // Warm caches, pools and lazily built tables
+    return summarize(move(name), timeRuns(samples, calls, body), calls);
+}
+
+static bool loadFrames(const string& path, FrameSet& set) {
+    auto source = openInputSource(path);
+    if (!source) return false;
+    set.name = "images";
+    Mat frame;
+    while (static_cast<int>(set.frames.size()) < MAX_FRAMES && source->read(frame)) {
+        set.frames.push_back(frame.clone());
+    }
+    return !set.frames.empty();
+}
+
+static vector<Mat> resizedFrames(const FrameSet& set, Size size) {
+    vector<Mat> frames;
+    for (const Mat& frame : set.frames) {
+        Mat resized;
+        resize(frame, resized, size, 0, 0, INTER_AREA);
+        frames.push_back(resized);
+    }
+    return frames;
+}
+
+static void benchTint(const FrameSet& set, vector<Result>& results) {
+    for (Size size : RESOLUTIONS) {
+        vector<Mat> frames = resizedFrames(set, size);
+        Mat display;
+        results.push_back(measure("tint/" + set.name + "/" + sizeName(size), SAMPLES, 1, [&](int i) {
+            applyTint(frames[i % frames.size()], display, false);
+        }));
+    }
+}
+
+static void fillKernelLogs() {
+    clearKernelLogs();
+    for (int i = 0; i < MAX_LOG_ENTRIES; i++) addKernelLog("Processing unit " + to_string(i) + " online", i % 4);
+}
+
+// The log panel on its own: layer update plus compose, with the log unchanged
+// and with a new line arriving before every frame
+static void benchKernelLog(const FrameSet& set, vector<Result>& results) {
+    for (Size size : RESOLUTIONS) {
+        Mat display;
+        applyTint(resizedFrames(set, size)[0], display, false);
+        const string line = "Face detected";
+
+        fillKernelLogs();
+        HudLayer steady;
+        results.push_back(measure("kernel_log/steady/" + sizeName(size), SAMPLES, 1, [&](int) {
+            drawKernelLogs(steady, 0, display.size(), false);
+            steady.compose(display);
+        }));
+
+        HudLayer scrolling;
+        results.push_back(measure("kernel_log/new_line/" + sizeName(size), SAMPLES, 1, [&](int) {
+            addKernelLog(line, 1);
+            drawKernelLogs(scrolling, 0, display.size(), false);
+            scrolling.compose(display);
+        }));
+    }
+}
+
+// Everything drawHud() does for one frame of a stream with two tracked faces,
+// with the same figures every frame and with the FPS ticking over
+static void benchHud(const FrameSet& set, vector<Result>& results) {
+    SystemStats stats;
+    stats.cpuUsage = 31.25f;
+    stats.ramUsage = 42.17f;
+    stats.storageUsage = 63.02f;
+    stats.busiestCore = 78.0f;
+    stats.processCpu = 87.0f;
+    stats.processRssMb = 143.0f;
+    stats.hotThread = "detect0";
+    stats.hotThreadCpu = 61.0f;
+    stats.netStatus = "Connected 12 ms";
+    stats.dateTime = "2024-05-01 08:00:00";
+
+    vector<FaceTrack> tracks(2);
+    tracks[0].id = 1;
+    tracks[0].box = Rect2f(120, 100, 90, 110);
+    tracks[1].id = 2;
+    tracks[1].box = Rect2f(380, 140, 70, 85);
+    tracks[1].velocity = Point2f(1.5f, 0.0f);
+
+    fillKernelLogs();
+    vector<string> stageLines;
+    describeStageLatencies(stageLines);
+
+    HudFrame hud;
+    hud.fps = 23.9f;
+    hud.stats = &stats;
+    hud.detectQueue = {1, 2, 17};
+    hud.renderQueue = {0, 2, 3};
+    hud.controller = "DET 1/3 x0.75 s1.10 9.8ms";
+    hud.stageLines = &stageLines;
+    hud.tracks = &tracks;
+
+    for (Size size : RESOLUTIONS) {
+        Mat frame = resizedFrames(set, size)[0];
+        Mat display;
+
+        HudLayer steady;
+        results.push_back(measure("hud/steady/" + sizeName(size), SAMPLES, 1, [&](int) {
+            applyTint(frame, display, false);
+            drawHud(display, steady, hud);
+        }));
+
+        HudLayer ticking;
+        HudFrame changing = hud;
+        results.push_back(measure("hud/fps_changed/" + sizeName(size), SAMPLES, 1, [&](int i) {
+            changing.fps = 20.0f + (i % 100) * 0.1f;
+            changing.seq = i;
+            applyTint(frame, display, false);
+            drawHud(display, ticking, changing);
+        }));
+    }
+}
+
+static void benchRectDistance(vector<Result>& results) {
+    RNG rng(4242);
+    vector<Rect> a(RECT_PAIRS), b(RECT_PAIRS);
+    for (int i = 0; i < RECT_PAIRS; i++) {
+        a[i] = Rect(rng.uniform(0, 600), rng.uniform(0, 440), rng.uniform(20, 200), rng.uniform(20, 200));
+        b[i] = Rect(rng.uniform(0, 600), rng.uniform(0, 440), rng.uniform(20, 200), rng.uniform(20, 200));
+    }
+    volatile double sink = 0.0;
+    results.push_back(measure("rect_distance", SAMPLES, RECT_PAIRS, [&](int i) {
+        sink = sink + calculateRectDistance(a[i % RECT_PAIRS], b[i % RECT_PAIRS]);
+    }));
+}
+
+// Per-call cost of addKernelLog while `threads` threads all log at once; every
+// thread's samples are pooled
+static void benchAddKernelLog(int threads, vector<Result>& results) {
+    clearKernelLogs();
+    vector<vector<double>> perThread(threads);
+    atomic<int> ready{0};
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            const string message = "Worker " + to_string(t) + " processed a frame";
+            ready++;
+            while (ready.load() < threads) this_thread::yield();
+            perThread[t] = timeRuns(SAMPLES, LOG_CALLS, [&](int) { addKernelLog(message, 0); });
+        });
+    }
+    for (auto& worker : workers) worker.join();
+
+    vector<double> pooled;
+    for (const auto& samples : perThread) pooled.insert(pooled.end(), samples.begin(), samples.end());
+    results.push_back(summarize("add_kernel_log/threads=" + to_string(threads), move(pooled), LOG_CALLS));
+}
+
+// A full-frame pass with the default parameters, on the working frame size
+static bool benchDetect(const FrameSet& set, const vector<int>& threadCounts, vector<Result>& results) {
+    vector<Mat> frames = resizedFrames(set, WORKING_SIZE);
+    for (int threads : threadCounts) {
+        auto detector = createFaceDetector(DetectorConfig(), threads);
+        if (!detector) return false;
+        Mat gray;
+        vector<Rect> faces;
+        results.push_back(measure("detect/" + set.name + "/" + sizeName(WORKING_SIZE) + "/threads="
+                                      + to_string(threads),
+                                  DETECT_SAMPLES, 1, [&](int i) {
+                                      detectFaces(*detector, frames[i % frames.size()], Mat(), gray, faces);
+                                  }));
+    }
+    return true;
+}
+
+static void writeReport(ostream& out, const vector<Result>& results) {
+    out << "{\"results\": [" << endl;
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        out << fixed << setprecision(1) << "  {\"name\": \"" << r.name << "\", \"median_ns\": " << r.medianNs
+            << ", \"p95_ns\": " << r.p95Ns << ", \"samples\": " << r.samples << ", \"calls\": " << r.calls << "}"
+            << (i + 1 < results.size() ? "," : "") << endl;
+    }
+    out << "]}" << endl;
+}
+
+// Reads the name and median of every result in a report this tool wrote: one
+// result object per line
+static bool readBaseline(const string& path, map<string, double>& medians) {
+    ifstream in(path);
+    if (!in) return false;
+    string line;
+    while (getline(in, line)) {
+        size_t name = line.find("\"name\": \"");
+        size_t median = line.find("\"median_ns\": ");
+        if (name == string::npos || median == string::npos) continue;
+        name += strlen("\"name\": \"");
+        size_t end = line.find('"', name);
+        if (end == string::npos) continue;
+        medians[line.substr(name, end - name)] = strtod(line.c_str() + median + strlen("\"median_ns\": "), nullptr);
+    }
+    return true;
+}
+
+// Prints a comparison table to stderr; returns how many kernels regressed
+static int compare(const vector<Result>& results, const map<string, double>& baseline, double tolerance) {
+    int regressions = 0;
+    cerr << left << setw(40) << "KERNEL" << right << setw(14) << "BASE ns" << setw(14) << "NOW ns" << setw(10)
+         << "CHANGE" << "  STATUS" << endl;
+    for (const Result& r : results) {
+        auto it = baseline.find(r.name);
+        cerr << left << setw(40) << r.name << right << fixed << setprecision(1);
+        if (it == baseline.end() || it->second <= 0.0) {
+            cerr << setw(14) << "-" << setw(14) << r.medianNs << setw(10) << "-" << "  new" << endl;
+            continue;
+        }
+        double change = r.medianNs / it->second - 1.0;
+        bool regressed = change > tolerance;
+        if (regressed) regressions++;
+        cerr << setw(14) << it->second << setw(14) << r.medianNs << setw(9) << showpos << change * 100 << noshowpos
+             << "%" << (regressed ? "  REGRESSED" : "  ok") << endl;
+    }
+    return regressions;
+}
+
+static void usage(const char* argv0) {
+    cerr << "Usage: " << argv0
+         << " [--images DIR] [--out FILE] [--baseline FILE] [--tolerance FRACTION] [--no-detect]" << endl;
+}
+
+int main(int argc, char** argv) {
+    string imagesPath, outPath, baselinePath;
+    double tolerance = DEFAULT_TOLERANCE;
+    bool detect = true;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--images" && hasValue) {
+            imagesPath = argv[++i];
+        } else if (arg == "--out" && hasValue) {
+            outPath = argv[++i];
+        } else if (arg == "--baseline" && hasValue) {
+            baselinePath = argv[++i];
+        } else if (arg == "--tolerance" && hasValue) {
+            tolerance = atof(argv[++i]);
+        } else if (arg == "--no-detect") {
+            detect = false;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    map<string, double> baseline;
+    if (!baselinePath.empty() && !readBaseline(baselinePath, baseline)) {
+        cerr << "Cannot read baseline " << baselinePath << endl;
+        return 2;
+    }
+
+    vector<FrameSet> sets = {FrameSet{"synthetic", syntheticFaceFrames(SYNTHETIC_FRAMES, CV_8UC3)}};
+    if (!imagesPath.empty()) {
+        FrameSet images;
+        if (!loadFrames(imagesPath, images)) {
+            cerr << "No frames in " << imagesPath << endl;
+            return 2;
+        }
+        sets.push_back(move(images));
+    }
+
+    vector<Result> results;
+    for (const FrameSet& set : sets) benchTint(set, results);
+    benchKernelLog(sets[0], results);
+    benchHud(sets[0], results);
+    benchRectDistance(results);
+
+    int cores = static_cast<int>(max(1u, thread::hardware_concurrency()));
+    benchAddKernelLog(1, results);
+    if (cores > 1) benchAddKernelLog(cores, results);
+
+    if (detect) {
+        vector<int> threadCounts = {1};
+        if (cores > 1) threadCounts.push_back(cores);
+        for (const FrameSet& set : sets) {
+            if (!benchDetect(set, threadCounts, results)) {
+                cerr << "Skipping detection: cascade not available" << endl;
+                break;
+            }
+        }
+    }
+
+    if (outPath.empty()) {
+        writeReport(cout, results);
+    } else {
+        ofstream out(outPath);
+        writeReport(out, results);
+        if (!out) {
+            cerr << "Cannot write " << outPath << endl;
+            return 2;
+        }
+        cerr << results.size() << " kernels written to " << outPath << endl;
+    }
+
+    if (baselinePath.empty()) return 0;
+    int regressions = compare(results, baseline, tolerance);
+    if (regressions > 0) {
+        cerr << regressions << " kernel(s) more than " << tolerance * 100 << "% slower than " << baselinePath
+             << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,97 @@
+// Cost of one system metrics sample.
+//
+// "before" is what systemMonitor used to do every second: open fresh ifstreams
+// for /proc/stat, /proc/meminfo and the battery, parse them with istringstream
+// and sscanf, and call statvfs. "after" is MetricsSampler, which also collects
+// per-core, per-process and per-thread figures. Most of the cost is the kernel
+// generating each file, so "after full" grows by one read per thread.
+
+#include "../metrics_sampler.hpp"
+#include "bench_util.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/statvfs.h>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+static const int ITERATIONS = 2000;
+static const int BACKGROUND_THREADS = 8; // Gives the per-thread scan something to read
+
+static long double prevTotal = 0, prevIdle = 0;
+
+static float legacySample() {
+    ifstream statFile("/proc/stat");
+    string line;
+    getline(statFile, line);
+    statFile.close();
+    istringstream ss(line);
+    string cpu;
+    long double user, nice, system, idle, iowait, irq, softirq, steal;
+    ss >> cpu >> user >> nice >> system >> idle >> iowait >> irq >> softirq >> steal;
+    long double totalCpu = user + nice + system + idle + iowait + irq + softirq + steal;
+    float cpuUsage = (prevTotal == 0) ? 0 : 100.0 * (1 - (idle - prevIdle) / (totalCpu - prevTotal));
+    prevTotal = totalCpu;
+    prevIdle = idle;
+
+    ifstream meminfo("/proc/meminfo");
+    long long total = 0, free = 0, available = 0;
+    while (getline(meminfo, line)) {
+        if (line.find("MemTotal:") == 0) sscanf(line.c_str(), "MemTotal: %lld kB", &total);
+        else if (line.find("MemFree:") == 0) sscanf(line.c_str(), "MemFree: %lld kB", &free);
+        else if (line.find("MemAvailable:") == 0) sscanf(line.c_str(), "MemAvailable: %lld kB", &available);
+    }
+
+    ifstream batteryFile("/sys/class/power_supply/BAT0/capacity");
+    int capacity = 0;
+    if (batteryFile.is_open()) batteryFile >> capacity;
+
+    struct statvfs stat;
+    statvfs("/", &stat);
+    return cpuUsage + total + free + available + capacity;
+}
+
+int main() {
+    atomic<bool> stop{false};
+    vector<thread> background;
+    for (int i = 0; i < BACKGROUND_THREADS; i++) {
+        background.emplace_back([&stop] {
+            while (!stop) this_thread::sleep_for(chrono::milliseconds(5));
+        });
+    }
+
+    volatile float sink = 0;
+    double beforeUs = medianTime<micro>(ITERATIONS, [&](int) { sink = sink + legacySample(); });
+
+    MetricsSampler systemSampler(false);
+    MetricsSnapshot systemSnapshot;
+    double systemUs = medianTime<micro>(ITERATIONS, [&](int) { systemSampler.sample(systemSnapshot); });
+
+    MetricsSampler sampler;
+    MetricsSnapshot snapshot;
+    double afterUs = medianTime<micro>(ITERATIONS, [&](int) { sampler.sample(snapshot); });
+
+    stop = true;
+    for (auto& t : background) t.join();
+
+    cout << left << setw(14) << "SAMPLER" << right << setw(12) << "us/SAMPLE"
+         << setw(8) << "CORES" << setw(9) << "THREADS" << setw(16) << "CPU @ 100ms" << endl;
+    cout << left << setw(14) << "before" << right << fixed << setprecision(1) << setw(12) << beforeUs
+         << setw(8) << "-" << setw(9) << "-" << setprecision(4) << setw(15) << beforeUs / 1000.0 << "%" << endl;
+    cout << left << setw(14) << "after system" << right << fixed << setprecision(1) << setw(12) << systemUs
+         << setw(8) << systemSnapshot.coreUsage.size() << setw(9) << "-"
+         << setprecision(4) << setw(15) << systemUs / 1000.0 << "%" << endl;
+    cout << left << setw(14) << "after full" << right << fixed << setprecision(1) << setw(12) << afterUs
+         << setw(8) << snapshot.coreUsage.size() << setw(9) << snapshot.threads.size()
+         << setprecision(4) << setw(15) << afterUs / 1000.0 << "%" << endl;
+    cout << "CPU @ 100ms is the share of one core spent sampling ten times a second" << endl;
+    return 0;
+}
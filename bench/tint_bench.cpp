@@ -0,0 +1,70 @@
+// Before/after microbenchmark for the HUD tint pass.
+//
+// "before" is what the render loop used to do: copy the shared frame, then
+// tint it in place with Mat::forEach and double-precision math. "after" is the
+// LUT kernel, which tints straight from the shared frame into the output.
+
+#include "../tint.hpp"
+#include "bench_util.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+static const int ITERATIONS = 200;
+
+static void legacyTint(Mat& frame, bool analysisMode) {
+    frame.forEach<Vec3b>([analysisMode](Vec3b& pixel, const int*) -> void {
+        if (analysisMode) {
+            pixel[0] = static_cast<uchar>(min(pixel[0] * 1.5, 255.0));
+            pixel[1] = static_cast<uchar>(pixel[1] * 0.5);
+            pixel[2] = static_cast<uchar>(pixel[2] * 0.5);
+        } else {
+            pixel[0] = static_cast<uchar>(pixel[0] * 0.5);
+            pixel[1] = static_cast<uchar>(pixel[1] * 0.5);
+            pixel[2] = static_cast<uchar>(min(pixel[2] * 1.5, 255.0));
+        }
+    });
+}
+
+int main() {
+    const vector<Size> sizes = {Size(640, 480), Size(1280, 720), Size(1920, 1080)};
+
+    cout << left << setw(12) << "SIZE" << setw(10) << "MODE" << right
+         << setw(16) << "BEFORE ns/px" << setw(15) << "AFTER ns/px" << setw(10) << "SPEEDUP" << endl;
+
+    bool allMatch = true;
+    for (const Size& size : sizes) {
+        Mat src(size, CV_8UC3);
+        randu(src, Scalar::all(0), Scalar::all(256));
+        double pixels = static_cast<double>(size.area());
+
+        for (bool analysisMode : {false, true}) {
+            Mat before, after;
+            double beforeNs = medianTime<nano>(ITERATIONS, [&](int) {
+                src.copyTo(before);
+                legacyTint(before, analysisMode);
+            });
+            double afterNs = medianTime<nano>(ITERATIONS, [&](int) { applyTint(src, after, analysisMode); });
+
+            // The LUT must reproduce the old per-pixel math exactly
+            if (norm(before, after, NORM_INF) != 0) {
+                allMatch = false;
+                cerr << "Mismatch at " << size.width << "x" << size.height << endl;
+            }
+
+            string res = to_string(size.width) + "x" + to_string(size.height);
+            cout << left << setw(12) << res << setw(10) << (analysisMode ? "analysis" : "monitor") << right
+                 << fixed << setprecision(3) << setw(16) << beforeNs / pixels
+                 << setw(15) << afterNs / pixels
+                 << setprecision(1) << setw(9) << beforeNs / afterNs << "x" << endl;
+        }
+    }
+
+    return allMatch ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+#include "camera_stream.hpp"
+#include "detection_scheduler.hpp"
+#include "face_detector.hpp"
+#include "frame_pool.hpp"
+#include "snapshot_writer.hpp"
+#include "stage_metrics.hpp"
+#include "thread_name.hpp"
+
+#include <iostream>
+
+using namespace std;
+using namespace cv;
+
+CameraStream::CameraStream(unique_ptr<FrameSource> source, const string& snapshotDir,
+                           SnapshotWriter& writer, const StreamConfig& config)
+    : source(std::move(source)),
+      tracker(snapshotDir, SnapshotNaming::Timestamp, true, writer, config.dedup),
+      tracks(config.fullSweepInterval),
+      motion(config.motion),
+      controller(config.detection),
+      detectQueue(config.queueDepth, config.queuePolicy),
+      renderQueue(config.queueDepth, config.queuePolicy),
+      resultQueue(config.queueDepth, config.queuePolicy),
+      lastFpsTime(chrono::steady_clock::now()) {
+    if (config.clips.enabled) clips = make_unique<ClipRecorder>(config.clips, snapshotDir, name());
+}
+
+CameraStream::~CameraStream() {
+    stop();
+}
+
+void CameraStream::start(DetectionScheduler& scheduler) {
+    scheduler.addStream([this](FaceDetector& detector) { return detectNext(detector); });
+    if (clips) clips->start();
+    captureThread = thread(&CameraStream::captureLoop, this, ref(scheduler));
+}
+
+void CameraStream::stop() {
+    detectQueue.close();
+    renderQueue.close();
+    resultQueue.close();
+    if (captureThread.joinable()) captureThread.join();
+    if (clips) clips->stop();
+}
+
+// Capture stage: reads the source and fans frames out to detection and rendering
+void CameraStream::captureLoop(DetectionScheduler& scheduler) {
+    setCurrentThreadName("cap:" + name());
+    Mat frame;
+    attachFramePool(frame);
+    LumaPlane luma;
+    uint64_t seq = 0;
+    uint64_t lastDetectSeq = 0;
+    bool detectedAny = false;
+
+    // Recorded inputs are played back at their own rate, like a camera would deliver them
+    auto playbackStart = chrono::steady_clock::now();
+    auto frameInterval = chrono::duration_cast<chrono::steady_clock::duration>(
+        chrono::duration<double>(1.0 / source->fps()));
+
+    while (true) {
+        if (!source->isLive()) {
+            this_thread::sleep_until(playbackStart + frameInterval * static_cast<int64_t>(seq));
+        }
+        bool captured;
+        {
+            ScopedStageTimer timer(Stage::Capture);
+            captured = source->readWithLuma(frame, luma);
+        }
+        if (!captured) {
+            cerr << name() << ": failed to capture frame!" << endl;
+            break;
+        }
+        auto captureTime = chrono::steady_clock::now();
+
+        FramePacket packet;
+        packet.seq = seq++;
+        if (frame.size() == Size(640, 480)) {
+            // Already the working size: hand the buffer over instead of copying
+            // it. The next read takes a recycled one from the frame pool.
+            packet.frame = std::move(frame);
+            attachFramePool(frame);
+            packet.luma = std::move(luma);
+        } else {
+            ScopedStageTimer timer(Stage::Resize);
+            attachFramePool(packet.frame);
+            resize(frame, packet.frame, Size(640, 480));
+        }
+        luma = LumaPlane(); // Returns a camera buffer lent for a frame that was resized
+        if (clips) clips->submit(packet.frame, captureTime);
+
+        // Count from the last forwarded frame so interval changes take effect
+        // smoothly
+        uint64_t interval = controller.params().interval;
+        if (!detectedAny || packet.seq - lastDetectSeq >= interval) {
+            if (detectQueue.push(packet)) { // Shares the pixel buffer, no copy
+                scheduler.notify();
+            }
+            lastDetectSeq = packet.seq;
+            detectedAny = true;
+        }
+        // Rendering works from BGR; holding luma there would only tie up camera buffers
+        packet.luma = LumaPlane();
+        if (!renderQueue.push(std::move(packet))) break;
+    }
+
+    detectQueue.close();
+    renderQueue.close();
+}
+
+// Detection stage, run by whichever scheduler worker picks this stream: runs
+// the cascade, maintains the face tracks and drives the capture/cooldown state
+// machine
+bool CameraStream::detectNext(FaceDetector& detector) {
+    FramePacket packet;
+    if (!detectQueue.tryPop(packet)) return false;
+
+    auto now = chrono::steady_clock::now();
+    motion.update(packet.frame, packet.luma.gray);
+    detectTrackedFaces(detector, tracks, packet.frame, packet.luma.gray, gray, packet.seq, now, controller.params(),
+                       &motion);
+    controller.recordDetection(chrono::duration<double, milli>(chrono::steady_clock::now() - now).count());
+
+    // The packet frame is never drawn on, so it is already clean for snapshots
+    if (tracker.update(tracks.tracks(), packet.frame, now, packet.seq) && clips) clips->trigger(now);
+
+    DetectionResult result;
+    result.seq = packet.seq;
+    result.tracks = tracks.tracks();
+    resultQueue.push(std::move(result));
+    return true;
+}
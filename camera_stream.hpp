@@ -0,0 +1,91 @@
+#pragma once
+
+#include "clip_recorder.hpp"
+#include "detection_controller.hpp"
+#include "face_tracker.hpp"
+#include "frame_queue.hpp"
+#include "frame_source.hpp"
+#include "hud_layer.hpp"
+#include "motion_gate.hpp"
+#include "multi_tracker.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+class DetectionScheduler;
+class FaceDetector;
+class SnapshotWriter;
+
+// Frame handed from the capture stage to detection and rendering
+struct FramePacket {
+    uint64_t seq = 0;
+    cv::Mat frame; // 640x480 BGR, shared read-only between stages
+    LumaPlane luma; // Native luma of frame, detection packets only; may be empty
+};
+
+// Face tracks as of a detection pass, tagged with the frame it ran on
+struct DetectionResult {
+    uint64_t seq = 0;
+    std::vector<FaceTrack> tracks;
+};
+
+struct StreamConfig {
+    size_t queueDepth = 2;
+    QueuePolicy queuePolicy = QueuePolicy::DropOldest;
+    DetectionControllerConfig detection;
+    int fullSweepInterval = 5; // Detection passes per full-frame scan
+    SnapshotDedupConfig dedup;
+    ClipConfig clips;
+    MotionGateConfig motion;
+};
+
+// One camera's pipeline: its source, the queues between its stages, and the
+// tracking, snapshot and render state that used to be process-wide. Capture
+// runs on the stream's own thread; detection runs on the shared scheduler.
+struct CameraStream {
+    CameraStream(std::unique_ptr<FrameSource> source, const std::string& snapshotDir,
+                 SnapshotWriter& writer, const StreamConfig& config);
+    ~CameraStream();
+
+    CameraStream(const CameraStream&) = delete;
+    CameraStream& operator=(const CameraStream&) = delete;
+
+    // Registers the detection step and starts the capture thread
+    void start(DetectionScheduler& scheduler);
+
+    // Closes the queues, joins the capture thread and flushes the clip recorder
+    void stop();
+
+    const std::string& name() const { return source->name(); }
+
+    std::unique_ptr<FrameSource> source;
+    std::unique_ptr<ClipRecorder> clips; // Null unless clip recording is enabled
+    FaceTracker tracker;
+    MultiFaceTracker tracks;
+    MotionGate motion; // Updated by the detection stage; stats() is safe from the render loop
+    DetectionController controller;
+    FrameQueue<FramePacket> detectQueue;
+    FrameQueue<FramePacket> renderQueue;
+    FrameQueue<DetectionResult> resultQueue;
+
+    // Render-side state, only touched by the render loop
+    cv::Mat display;
+    HudLayer hud;
+    std::vector<DetectionResult> pendingResults; // Keeps its capacity, unlike a deque
+    DetectionResult latestResult;
+    float fps = 0.0f;
+    int frameCount = 0;
+    std::chrono::steady_clock::time_point lastFpsTime;
+
+private:
+    void captureLoop(DetectionScheduler& scheduler);
+    bool detectNext(FaceDetector& detector);
+
+    std::thread captureThread;
+    cv::Mat gray;
+};
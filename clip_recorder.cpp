@@ -0,0 +1,314 @@
+#include "clip_recorder.hpp"
+#include "kernel_log.hpp"
+#include "thread_name.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+using namespace cv;
+
+// Descriptor slots per arena byte; a 640x480 JPEG is rarely under 8 KB
+static const size_t BYTES_PER_ENTRY = 4096;
+static const size_t MIN_ENTRIES = 64;
+static const size_t ENCODER_QUEUE_DEPTH = 2;
+static const size_t MAX_PENDING_CLIPS = 2;
+
+EncodedFrameRing::EncodedFrameRing(size_t bytes, size_t maxFrames)
+    : arena(bytes), entries(max(maxFrames, size_t(1))) {}
+
+void EncodedFrameRing::popOldest() {
+    head = (head + 1) % entries.size();
+    count--;
+}
+
+bool EncodedFrameRing::push(const uint8_t* data, size_t length, int64_t timeUs) {
+    if (length == 0 || length > arena.size()) return false;
+
+    if (writePos + length > arena.size()) {
+        // Frames past writePos are the previous lap's, so the oldest: drop them
+        // all before starting over at the front
+        while (count > 0 && at(0).offset >= writePos) popOldest();
+        writePos = 0;
+    }
+    size_t end = writePos + length;
+    while (count > 0 && (count == entries.size() || (at(0).offset < end && writePos < at(0).offset + at(0).length))) {
+        popOldest();
+    }
+
+    memcpy(arena.data() + writePos, data, length);
+    entries[(head + count) % entries.size()] = Entry{timeUs, writePos, length};
+    count++;
+    writePos = end;
+    return true;
+}
+
+static int64_t steadyMicros(chrono::steady_clock::time_point t) {
+    return chrono::duration_cast<chrono::microseconds>(t.time_since_epoch()).count();
+}
+
+static void putU32(ofstream& out, uint32_t v) {
+    uint8_t b[4] = {uint8_t(v), uint8_t(v >> 8), uint8_t(v >> 16), uint8_t(v >> 24)};
+    out.write(reinterpret_cast<const char*>(b), 4);
+}
+
+static void putU16(ofstream& out, uint16_t v) {
+    uint8_t b[2] = {uint8_t(v), uint8_t(v >> 8)};
+    out.write(reinterpret_cast<const char*>(b), 2);
+}
+
+static void putFourcc(ofstream& out, const char* fourcc) {
+    out.write(fourcc, 4);
+}
+
+// Writes already-encoded JPEG frames as an MJPEG AVI, without re-encoding them
+static bool writeMjpegAvi(const string& path, const vector<uint8_t>& data, const vector<size_t>& lengths,
+                          Size size, double fps) {
+    ofstream out(path, ios::binary);
+    if (!out) return false;
+
+    const uint32_t AVIF_HASINDEX = 0x10;
+    const uint32_t AVIIF_KEYFRAME = 0x10;
+    uint32_t frames = static_cast<uint32_t>(lengths.size());
+    uint32_t largest = 0;
+    uint32_t moviBytes = 4; // 'movi'
+    for (size_t length : lengths) {
+        largest = max(largest, static_cast<uint32_t>(length));
+        moviBytes += 8 + static_cast<uint32_t>((length + 1) & ~size_t(1));
+    }
+    uint32_t strlBytes = 4 + (8 + 56) + (8 + 40);
+    uint32_t hdrlBytes = 4 + (8 + 56) + (8 + strlBytes);
+    uint32_t idxBytes = 16 * frames;
+    uint32_t riffBytes = 4 + (8 + hdrlBytes) + (8 + moviBytes) + (8 + idxBytes);
+    uint32_t rateScale = 1000;
+    uint32_t rate = static_cast<uint32_t>(lround(fps * rateScale));
+
+    putFourcc(out, "RIFF");
+    putU32(out, riffBytes);
+    putFourcc(out, "AVI ");
+
+    putFourcc(out, "LIST");
+    putU32(out, hdrlBytes);
+    putFourcc(out, "hdrl");
+    putFourcc(out, "avih");
+    putU32(out, 56);
+    putU32(out, static_cast<uint32_t>(lround(1e6 / fps))); // Microseconds per frame
+    putU32(out, static_cast<uint32_t>(largest * fps));    // Max bytes per second
+    putU32(out, 0);                                        // Padding granularity
+    putU32(out, AVIF_HASINDEX);
+    putU32(out, frames);
+    putU32(out, 0); // Initial frames
+    putU32(out, 1); // Streams
+    putU32(out, largest);
+    putU32(out, size.width);
+    putU32(out, size.height);
+    for (int i = 0; i < 4; i++) putU32(out, 0);
+
+    putFourcc(out, "LIST");
+    putU32(out, strlBytes);
+    putFourcc(out, "strl");
+    putFourcc(out, "strh");
+    putU32(out, 56);
+    putFourcc(out, "vids");
+    putFourcc(out, "MJPG");
+    putU32(out, 0); // Flags
+    putU16(out, 0); // Priority
+    putU16(out, 0); // Language
+    putU32(out, 0); // Initial frames
+    putU32(out, rateScale);
+    putU32(out, rate);
+    putU32(out, 0); // Start
+    putU32(out, frames);
+    putU32(out, largest);
+    putU32(out, 0xFFFFFFFF); // Default quality
+    putU32(out, 0);          // Sample size: varies
+    putU16(out, 0);
+    putU16(out, 0);
+    putU16(out, static_cast<uint16_t>(size.width));
+    putU16(out, static_cast<uint16_t>(size.height));
+    putFourcc(out, "strf");
+    putU32(out, 40); // BITMAPINFOHEADER
+    putU32(out, 40);
+    putU32(out, size.width);
+    putU32(out, size.height);
+    putU16(out, 1);  // Planes
+    putU16(out, 24); // Bits per pixel once decoded
+    putFourcc(out, "MJPG");
+    putU32(out, size.width * size.height * 3);
+    for (int i = 0; i < 4; i++) putU32(out, 0);
+
+    putFourcc(out, "LIST");
+    putU32(out, moviBytes);
+    putFourcc(out, "movi");
+    size_t offset = 0;
+    for (size_t length : lengths) {
+        putFourcc(out, "00dc");
+        putU32(out, static_cast<uint32_t>(length));
+        out.write(reinterpret_cast<const char*>(data.data() + offset), length);
+        if (length & 1) out.put('\0');
+        offset += length;
+    }
+
+    // Offsets count from the 'movi' tag
+    putFourcc(out, "idx1");
+    putU32(out, idxBytes);
+    uint32_t chunk = 4;
+    for (size_t length : lengths) {
+        putFourcc(out, "00dc");
+        putU32(out, AVIIF_KEYFRAME);
+        putU32(out, chunk);
+        putU32(out, static_cast<uint32_t>(length));
+        chunk += 8 + static_cast<uint32_t>((length + 1) & ~size_t(1));
+    }
+    return static_cast<bool>(out.flush());
+}
+
+ClipRecorder::ClipRecorder(const ClipConfig& config, string clipDir, string streamName)
+    : config(config),
+      clipDir(std::move(clipDir)),
+      streamName(std::move(streamName)),
+      ring(config.ringBytes, max(MIN_ENTRIES, config.ringBytes / BYTES_PER_ENTRY)),
+      frames(ENCODER_QUEUE_DEPTH, QueuePolicy::DropOldest),
+      encodeParams{IMWRITE_JPEG_QUALITY, config.jpegQuality} {}
+
+ClipRecorder::~ClipRecorder() {
+    stop();
+}
+
+void ClipRecorder::start() {
+    encoder = thread(&ClipRecorder::encodeLoop, this);
+    writer = thread(&ClipRecorder::writeLoop, this);
+}
+
+void ClipRecorder::stop() {
+    frames.close();
+    if (encoder.joinable()) encoder.join();
+    {
+        lock_guard<mutex> lock(mtx);
+        stopping = true;
+    }
+    notEmpty.notify_all();
+    if (writer.joinable()) writer.join();
+}
+
+void ClipRecorder::submit(const Mat& frame, chrono::steady_clock::time_point captured) {
+    frames.push(PendingFrame{frame, steadyMicros(captured)});
+}
+
+void ClipRecorder::trigger(chrono::steady_clock::time_point at) {
+    triggerUs = steadyMicros(at);
+}
+
+void ClipRecorder::encodeLoop() {
+    setCurrentThreadName("clip:" + streamName);
+    PendingFrame pending;
+    while (frames.pop(pending)) {
+        bool ok = false;
+        try {
+            ok = imencode(".jpg", pending.frame, encoded, encodeParams);
+        } catch (const cv::Exception& e) {
+            cerr << ("Clip encoder error: " + string(e.what()) + "\n") << flush;
+        }
+        Size size = pending.frame.size();
+        pending.frame.release(); // Back to the frame pool before the copies below
+        if (!ok) continue;
+        ring.push(encoded.data(), encoded.size(), pending.timeUs);
+
+        int64_t at = triggerUs.exchange(0);
+        if (recording) {
+            if (at) clipEndUs = max(clipEndUs, at + static_cast<int64_t>(config.postRollSeconds * 1e6));
+            if (pending.timeUs <= clipEndUs) {
+                appendToClip(encoded.data(), encoded.size(), pending.timeUs);
+            } else {
+                finishClip();
+            }
+        } else if (at) {
+            startClip(at, size);
+        }
+    }
+    if (recording) finishClip();
+}
+
+void ClipRecorder::startClip(int64_t atUs, Size size) {
+    string tag = getCurrentDateTime();
+    replace(tag.begin(), tag.end(), ' ', '_');
+    replace(tag.begin(), tag.end(), ':', '_');
+    active = Clip();
+    active.path = clipDir + "/clip_" + tag + ".avi";
+    active.size = size;
+    recording = true;
+    clipEndUs = atUs + static_cast<int64_t>(config.postRollSeconds * 1e6);
+
+    // Pre-roll straight from the ring, the frame just encoded included
+    int64_t fromUs = atUs - static_cast<int64_t>(config.preRollSeconds * 1e6);
+    for (size_t i = 0; i < ring.size() && recording; i++) {
+        const EncodedFrameRing::Entry& entry = ring.at(i);
+        if (entry.timeUs >= fromUs) appendToClip(ring.data(entry), entry.length, entry.timeUs);
+    }
+}
+
+void ClipRecorder::appendToClip(const uint8_t* data, size_t length, int64_t timeUs) {
+    // What the writer still holds counts against the same budget
+    size_t held = min(heldBytes.load(), config.clipBytes);
+    size_t room = config.clipBytes - held;
+    size_t needed = active.data.size() + length;
+    if (needed > room) {
+        if (active.lengths.empty()) cerr << ("Clip dropped, out of clip memory: " + active.path + "\n") << flush;
+        finishClip(); // Whatever is recorded so far is kept
+        return;
+    }
+    // Grow by hand so the reserved capacity never overshoots the budget
+    if (needed > active.data.capacity()) active.data.reserve(min(room, max(needed, active.data.capacity() * 2)));
+    if (active.lengths.empty()) active.firstUs = timeUs;
+    active.lastUs = timeUs;
+    active.data.insert(active.data.end(), data, data + length);
+    active.lengths.push_back(length);
+}
+
+void ClipRecorder::finishClip() {
+    recording = false;
+    if (active.lengths.empty()) return;
+    {
+        lock_guard<mutex> lock(mtx);
+        if (toWrite.size() >= MAX_PENDING_CLIPS) {
+            cerr << ("Clip dropped, writer busy: " + active.path + "\n") << flush;
+            active = Clip();
+            return;
+        }
+        heldBytes += active.data.capacity();
+        toWrite.push_back(std::move(active));
+    }
+    active = Clip();
+    notEmpty.notify_one();
+}
+
+void ClipRecorder::writeLoop() {
+    setCurrentThreadName("clipwr:" + streamName);
+    while (true) {
+        Clip clip;
+        {
+            unique_lock<mutex> lock(mtx);
+            notEmpty.wait(lock, [this] { return stopping || !toWrite.empty(); });
+            if (toWrite.empty()) return; // Stopping and nothing left to write
+            clip = std::move(toWrite.front());
+            toWrite.pop_front();
+        }
+
+        // Play back at the rate the frames were actually captured
+        double seconds = (clip.lastUs - clip.firstUs) / 1e6;
+        double fps = clip.lengths.size() > 1 && seconds > 0 ? (clip.lengths.size() - 1) / seconds : 1.0;
+        if (writeMjpegAvi(clip.path, clip.data, clip.lengths, clip.size, fps)) {
+            clips++;
+            cout << ("Clip saved: " + clip.path + "\n") << flush;
+            addKernelLog("Clip saved", 2);
+        } else {
+            cerr << ("Failed to save clip: " + clip.path + "\n") << flush;
+        }
+        size_t bytes = clip.data.capacity();
+        clip = Clip();
+        heldBytes -= bytes;
+    }
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "frame_queue.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ClipConfig {
+    bool enabled = false;
+    size_t ringBytes = 32 * 1024 * 1024; // Compressed pre-roll arena per stream
+    // Per stream, for the clip being recorded plus those queued or being
+    // written; a clip that would go over is cut short, or dropped if it has
+    // no frames yet
+    size_t clipBytes = 64 * 1024 * 1024;
+    double preRollSeconds = 10.0;
+    double postRollSeconds = 5.0;
+    int jpegQuality = 75;
+};
+
+// Fixed-size byte arena holding the most recent encoded frames in arrival
+// order. Frames are laid out back to back and wrap at the end; adding one
+// evicts the oldest frames it would overwrite. Never allocates after
+// construction.
+class EncodedFrameRing {
+public:
+    struct Entry {
+        int64_t timeUs = 0; // Capture time, steady clock
+        size_t offset = 0;
+        size_t length = 0;
+    };
+
+    EncodedFrameRing(size_t bytes, size_t maxFrames);
+
+    // False if the frame is larger than the whole arena
+    bool push(const uint8_t* data, size_t length, int64_t timeUs);
+
+    size_t size() const { return count; }
+    const Entry& at(size_t i) const { return entries[(head + i) % entries.size()]; } // 0 = oldest
+    const uint8_t* data(const Entry& entry) const { return arena.data() + entry.offset; }
+
+private:
+    void popOldest();
+
+    std::vector<uint8_t> arena;
+    std::vector<Entry> entries;
+    size_t head = 0;
+    size_t count = 0;
+    size_t writePos = 0;
+};
+
+// Per-stream event recorder. Every captured frame is JPEG-encoded on the
+// recorder's own thread into an EncodedFrameRing, so the last few seconds are
+// always at hand in compressed form. trigger() turns the pre-roll plus the
+// following post-roll into an MJPEG AVI clip, written by a second background
+// thread. Frames arrive through a small drop-oldest queue, so a slow encoder
+// skips frames rather than holding up capture.
+class ClipRecorder {
+public:
+    ClipRecorder(const ClipConfig& config, std::string clipDir, std::string streamName);
+    ~ClipRecorder(); // Finishes the clip in progress and any queued for writing
+
+    ClipRecorder(const ClipRecorder&) = delete;
+    ClipRecorder& operator=(const ClipRecorder&) = delete;
+
+    void start();
+    void stop();
+
+    // Shares the frame's pixels with the encoder; called by the capture stage
+    void submit(const cv::Mat& frame, std::chrono::steady_clock::time_point captured);
+
+    // Records a clip around `at`; extends the post-roll of a clip already in
+    // progress. Called by the detection stage.
+    void trigger(std::chrono::steady_clock::time_point at);
+
+    uint64_t clipCount() const { return clips; }
+    uint64_t droppedFrames() const { return frames.droppedCount(); }
+
+private:
+    struct PendingFrame {
+        cv::Mat frame;
+        int64_t timeUs = 0;
+    };
+
+    // Encoded frames of one clip, back to back
+    struct Clip {
+        std::string path;
+        std::vector<uint8_t> data;
+        std::vector<size_t> lengths;
+        int64_t firstUs = 0;
+        int64_t lastUs = 0;
+        cv::Size size;
+    };
+
+    void encodeLoop();
+    void writeLoop();
+    void startClip(int64_t atUs, cv::Size size);
+    void appendToClip(const uint8_t* data, size_t length, int64_t timeUs);
+    void finishClip();
+
+    ClipConfig config;
+    std::string clipDir;
+    std::string streamName;
+    EncodedFrameRing ring;
+    FrameQueue<PendingFrame> frames;
+    std::vector<int> encodeParams;
+
+    // Encoder thread only
+    std::vector<uint8_t> encoded;
+    Clip active;
+    bool recording = false;
+    int64_t clipEndUs = 0;
+
+    std::atomic<int64_t> triggerUs{0}; // Pending trigger time, 0 = none
+
+    std::mutex mtx;
+    std::condition_variable notEmpty;
+    std::deque<Clip> toWrite;
+    bool stopping = false;
+    std::atomic<size_t> heldBytes{0}; // Clips queued or being written
+
+    std::atomic<uint64_t> clips{0};
+    std::thread encoder;
+    std::thread writer;
+};
@@ -0,0 +1,121 @@
+#include "detection_controller.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+using namespace std;
+
+struct Rung {
+    int interval;
+    double downscale;
+    double scaleFactor;
+};
+
+// Ordered by estimated cost per frame, roughly downscale^2 / (ln(scale) * interval).
+// Image size and pyramid step are given up before detection frequency.
+static const Rung LADDER[] = {
+    {1, 1.00, 1.10},
+    {1, 0.75, 1.10},
+    {1, 0.75, 1.20},
+    {2, 0.75, 1.20},
+    {3, 0.75, 1.20},
+    {3, 0.50, 1.20},
+    {4, 0.50, 1.30},
+    {6, 0.50, 1.30},
+    {8, 0.50, 1.30},
+};
+static const size_t LADDER_SIZE = sizeof(LADDER) / sizeof(LADDER[0]);
+static const size_t START_LEVEL = 2;
+
+static const double SMOOTHING = 0.2;          // EWMA weight of each new sample
+static const double UPGRADE_HEADROOM = 0.8;   // Predicted cost must fit in 80% of the budget
+static const int DEGRADE_STREAK = 3;          // Consecutive evaluations before stepping down
+static const int UPGRADE_STREAK = 15;         // ...and before stepping back up
+static const int SETTLE_SAMPLES = 5;          // Fresh samples needed after a change
+
+static double rungCost(const Rung& rung) {
+    return rung.downscale * rung.downscale / (log(rung.scaleFactor) * rung.interval);
+}
+
+DetectionController::DetectionController(const DetectionControllerConfig& config)
+    : config(config), level(START_LEVEL) {}
+
+DetectionParams DetectionController::params() const {
+    if (!config.enabled) return config.fixed;
+
+    lock_guard<mutex> lock(mtx);
+    DetectionParams params = config.fixed;
+    params.interval = LADDER[level].interval;
+    params.downscale = LADDER[level].downscale;
+    params.scaleFactor = LADDER[level].scaleFactor;
+    return params;
+}
+
+void DetectionController::recordDetection(double ms) {
+    if (!config.enabled) return;
+
+    lock_guard<mutex> lock(mtx);
+    detectMs = haveDetect ? detectMs + SMOOTHING * (ms - detectMs) : ms;
+    haveDetect = true;
+    samplesSinceChange++;
+    evaluateLocked();
+}
+
+void DetectionController::recordRender(double ms) {
+    if (!config.enabled) return;
+
+    lock_guard<mutex> lock(mtx);
+    renderMs = haveRender ? renderMs + SMOOTHING * (ms - renderMs) : ms;
+    haveRender = true;
+}
+
+void DetectionController::evaluateLocked() {
+    if (!haveRender || samplesSinceChange < SETTLE_SAMPLES) return;
+
+    const Rung& rung = LADDER[level];
+    double frameCost = renderMs + detectMs / rung.interval;
+
+    // Over budget if the amortised cost is too high, or if a detection pass no
+    // longer finishes before the next frame is due for detection
+    bool overBudget = frameCost > config.latencyBudgetMs
+                      || detectMs > rung.interval * config.targetFrameMs;
+
+    // Only move up if the next rung is predicted to fit with headroom
+    bool roomToGrow = false;
+    if (level > 0) {
+        const Rung& better = LADDER[level - 1];
+        double predictedDetect = detectMs * (rungCost(better) * better.interval) / (rungCost(rung) * rung.interval);
+        double predictedCost = renderMs + predictedDetect / better.interval;
+        roomToGrow = predictedCost < config.latencyBudgetMs * UPGRADE_HEADROOM
+                     && predictedDetect < better.interval * config.targetFrameMs * UPGRADE_HEADROOM;
+    }
+
+    overBudgetStreak = overBudget ? overBudgetStreak + 1 : 0;
+    underBudgetStreak = roomToGrow ? underBudgetStreak + 1 : 0;
+
+    if (overBudgetStreak >= DEGRADE_STREAK && level + 1 < LADDER_SIZE) {
+        level++;
+    } else if (underBudgetStreak >= UPGRADE_STREAK) {
+        level--;
+    } else {
+        return;
+    }
+    overBudgetStreak = 0;
+    underBudgetStreak = 0;
+    samplesSinceChange = 0;
+}
+
+void DetectionController::describe(char* text, size_t size) const {
+    DetectionParams current = params();
+    int used = 0;
+    if (config.enabled) {
+        lock_guard<mutex> lock(mtx);
+        used = snprintf(text, size, "ADAPT L%zu D:%.1fms R:%.1fms", level, detectMs, renderMs);
+    } else {
+        used = snprintf(text, size, "FIXED");
+    }
+    if (used < 0 || static_cast<size_t>(used) >= size) return;
+    snprintf(text + used, size - used, " 1/%d %.2fx SF%.2f", current.interval, current.downscale,
+             current.scaleFactor);
+}
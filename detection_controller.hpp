@@ -0,0 +1,50 @@
+#pragma once
+
+#include "face_tracker.hpp"
+
+#include <cstddef>
+#include <mutex>
+
+struct DetectionControllerConfig {
+    bool enabled = true;
+    double latencyBudgetMs = 30.0;    // Render + amortised detection cost allowed per displayed frame
+    double targetFrameMs = 41.666;    // Frame period a detection pass is budgeted against (24 FPS)
+    DetectionParams fixed;            // Used as-is when the controller is disabled
+};
+
+// Feedback controller that trades detection quality for frame time. It walks a
+// ladder of settings ordered by estimated cost, cheapest last; the costlier
+// rungs run detection more often. Measured costs are smoothed, and a rung is
+// only given up or regained after several consistent evaluations, so the
+// settings do not oscillate. Only measured costs count: the display interval
+// is paced by the camera, which may deliver fewer frames than the target rate
+// with the CPU idle.
+class DetectionController {
+public:
+    explicit DetectionController(const DetectionControllerConfig& config);
+
+    // Current settings; called from the capture and detection stages
+    DetectionParams params() const;
+
+    // Feed measurements; called from the detection and render stages
+    void recordDetection(double ms);
+    void recordRender(double ms);
+
+    // Short readout for the HUD, e.g. "ADAPT L3 D:12.0ms R:4.1ms 1/2 0.75x SF1.20",
+    // written into text (truncated to size) so the render loop does not allocate
+    void describe(char* text, size_t size) const;
+
+private:
+    void evaluateLocked();
+
+    DetectionControllerConfig config;
+    mutable std::mutex mtx;
+    size_t level;
+    double detectMs = 0.0;
+    double renderMs = 0.0;
+    bool haveDetect = false;
+    bool haveRender = false;
+    int overBudgetStreak = 0;
+    int underBudgetStreak = 0;
+    int samplesSinceChange = 0;
+};
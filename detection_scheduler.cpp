@@ -0,0 +1,89 @@
+#include "detection_scheduler.hpp"
+#include "thread_name.hpp"
+
+using namespace std;
+
+DetectionScheduler::DetectionScheduler(int workers, int threadsPerWorker)
+    : workerCount(max(1, workers)), threadsPerWorker(threadsPerWorker) {}
+
+DetectionScheduler::~DetectionScheduler() {
+    stop();
+}
+
+bool DetectionScheduler::load(const DetectorConfig& config) {
+    detectors.clear();
+    for (int i = 0; i < workerCount; i++) {
+        auto detector = createFaceDetector(config, threadsPerWorker);
+        if (!detector) return false;
+        detectors.push_back(std::move(detector));
+    }
+    return true;
+}
+
+void DetectionScheduler::addStream(StreamStep step) {
+    lock_guard<mutex> lock(mtx);
+    streams.push_back(std::move(step));
+    busy.push_back(false);
+}
+
+void DetectionScheduler::start() {
+    for (int i = 0; i < workers(); i++) {
+        threads.emplace_back(&DetectionScheduler::workerLoop, this, i);
+    }
+}
+
+void DetectionScheduler::notify() {
+    {
+        lock_guard<mutex> lock(mtx);
+        generation++;
+    }
+    wake.notify_one();
+}
+
+void DetectionScheduler::stop() {
+    {
+        lock_guard<mutex> lock(mtx);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : threads) t.join();
+    threads.clear();
+}
+
+void DetectionScheduler::workerLoop(int worker) {
+    setCurrentThreadName("detect-" + to_string(worker));
+    FaceDetector& detector = *detectors[worker];
+    unique_lock<mutex> lock(mtx);
+
+    while (!stopping) {
+        uint64_t seen = generation;
+        bool ran = false;
+
+        for (size_t n = 0; n < streams.size() && !stopping; n++) {
+            size_t i = (cursor + n) % streams.size();
+            if (busy[i]) continue;
+
+            busy[i] = true;
+            lock.unlock();
+            bool processed = streams[i](detector);
+            lock.lock();
+            busy[i] = false;
+
+            if (processed) {
+                // The next scan starts after this stream, whichever worker runs it
+                cursor = (i + 1) % streams.size();
+                ran = true;
+                break;
+            }
+        }
+
+        if (ran) {
+            // A worker that skipped this stream while it was busy may be asleep,
+            // and the stream may have more queued
+            generation++;
+            wake.notify_one();
+            continue;
+        }
+        wake.wait(lock, [&] { return stopping || generation != seen; });
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "face_detector.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Fixed set of detection workers shared by every camera stream, each with its
+// own FaceDetector. Streams are visited round-robin starting after the last one
+// served, so a busy stream cannot starve the others. A stream never runs on two
+// workers at once, so its tracking state needs no locking and its frames are
+// processed in order.
+class DetectionScheduler {
+public:
+    // Processes one queued frame of a stream with the given detector; returns
+    // false if the stream had nothing queued
+    using StreamStep = std::function<bool(FaceDetector&)>;
+
+    // threadsPerWorker is the pyramid parallelism of each worker's detector
+    DetectionScheduler(int workers, int threadsPerWorker);
+    ~DetectionScheduler();
+
+    DetectionScheduler(const DetectionScheduler&) = delete;
+    DetectionScheduler& operator=(const DetectionScheduler&) = delete;
+
+    // Creates every worker's detector
+    bool load(const DetectorConfig& config);
+
+    // All streams must be added before start()
+    void addStream(StreamStep step);
+    void start();
+
+    // Called by a stream after queueing a frame
+    void notify();
+
+    // Joins the workers; frames still queued are left for the streams to drop
+    void stop();
+
+    int workers() const { return workerCount; }
+
+private:
+    void workerLoop(int worker);
+
+    const int workerCount;
+    const int threadsPerWorker;
+    std::vector<std::unique_ptr<FaceDetector>> detectors;
+    std::vector<StreamStep> streams;
+    std::vector<bool> busy;
+    std::vector<std::thread> threads;
+    std::mutex mtx;
+    std::condition_variable wake;
+    uint64_t generation = 0; // Bumped by notify() so a scan racing a push is retried
+    size_t cursor = 0;       // Stream the next scan starts from
+    bool stopping = false;
+};
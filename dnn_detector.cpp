@@ -0,0 +1,78 @@
+#include "dnn_detector.hpp"
+
+#include <iostream>
+
+using namespace std;
+using namespace cv;
+
+// Per-channel mean the ResNet-10 face SSD was trained with
+static const Scalar INPUT_MEAN(104.0, 177.0, 123.0);
+
+// Columns of an SSD DetectionOutput row
+static const int DETECTION_COLUMNS = 7;
+
+DnnFaceDetector::DnnFaceDetector(const DetectorConfig& config) : config(config), single(1) {}
+
+bool DnnFaceDetector::load() {
+    // The default weights come with their own description; custom ones may not need one
+    string model = config.modelPath.empty() ? DNN_MODEL_PATH : config.modelPath;
+    string description = config.configPath.empty() && config.modelPath.empty() ? DNN_CONFIG_PATH
+                                                                              : config.configPath;
+    try {
+        net = dnn::readNet(model, description);
+    } catch (const cv::Exception& e) {
+        cerr << "Error loading network " << model << ": " << e.what() << endl;
+        return false;
+    }
+    if (net.empty()) {
+        cerr << "Error loading network " << model << endl;
+        return false;
+    }
+    net.setPreferableBackend(dnn::DNN_BACKEND_OPENCV);
+    net.setPreferableTarget(dnn::DNN_TARGET_CPU);
+    return true;
+}
+
+void DnnFaceDetector::detectMultiScale(const Mat& gray, vector<Rect>& faces, double scaleFactor,
+                                       int minNeighbors, Size minSize, Size maxSize) {
+    single[0].gray = gray;
+    single[0].minSize = minSize;
+    single[0].maxSize = maxSize;
+    detectBatch(single, scaleFactor, minNeighbors);
+    faces.swap(single[0].faces);
+    single[0].gray.release();
+}
+
+void DnnFaceDetector::detectBatch(vector<DetectionJob>& jobs, double, int) {
+    inputs.resize(jobs.size());
+    for (size_t i = 0; i < jobs.size(); i++) {
+        jobs[i].faces.clear();
+        cvtColor(jobs[i].gray, inputs[i], COLOR_GRAY2BGR);
+    }
+    if (jobs.empty()) return;
+
+    Mat blob = dnn::blobFromImages(inputs, 1.0, config.inputSize, INPUT_MEAN, false, false);
+    net.setInput(blob);
+    Mat output = net.forward();
+    if (output.dims != 4 || output.size[3] != DETECTION_COLUMNS) {
+        if (!warned) cerr << "Network output is not SSD detections; no faces reported" << endl;
+        warned = true;
+        return;
+    }
+
+    Mat rows(output.size[2], DETECTION_COLUMNS, CV_32F, output.ptr<float>());
+    for (int r = 0; r < rows.rows; r++) {
+        const float* row = rows.ptr<float>(r);
+        int image = static_cast<int>(row[0]);
+        if (image < 0 || image >= static_cast<int>(jobs.size()) || row[2] < config.confidence) continue;
+
+        DetectionJob& job = jobs[image];
+        Size size = job.gray.size();
+        Rect box = Rect(Point(cvRound(row[3] * size.width), cvRound(row[4] * size.height)),
+                        Point(cvRound(row[5] * size.width), cvRound(row[6] * size.height)))
+                   & Rect(0, 0, size.width, size.height);
+        if (box.width < job.minSize.width || box.height < job.minSize.height) continue;
+        if (!job.maxSize.empty() && (box.width > job.maxSize.width || box.height > job.maxSize.height)) continue;
+        job.faces.push_back(box);
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "face_detector.hpp"
+
+#include <opencv2/dnn.hpp>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// Face detector running an SSD-style network (OpenCV's ResNet-10 face SSD by
+// default) through the DNN module on the CPU. Any network whose output is SSD
+// DetectionOutput rows (image, class, score, x1, y1, x2, y2) works. Gray input
+// is replicated to three channels, and a batch of images goes through the
+// network in a single forward pass.
+class DnnFaceDetector : public FaceDetector {
+public:
+    explicit DnnFaceDetector(const DetectorConfig& config);
+
+    bool load();
+
+    void detectMultiScale(const cv::Mat& gray, std::vector<cv::Rect>& faces, double scaleFactor,
+                          int minNeighbors, cv::Size minSize, cv::Size maxSize = cv::Size()) override;
+
+    void detectBatch(std::vector<DetectionJob>& jobs, double scaleFactor, int minNeighbors) override;
+
+private:
+    DetectorConfig config;
+    cv::dnn::Net net;
+    std::vector<cv::Mat> inputs; // BGR copies of the batch, reused between calls
+    std::vector<DetectionJob> single;
+    bool warned = false;
+};
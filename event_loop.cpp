@@ -0,0 +1,181 @@
+#include "event_loop.hpp"
+#include "thread_name.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+using namespace std;
+
+// epoll tags for the loop's own descriptors; watches are tagged with their ID
+static const uint64_t TIMER_TAG = UINT64_MAX;
+static const uint64_t WAKE_TAG = UINT64_MAX - 1;
+
+EventLoop::EventLoop() = default;
+
+EventLoop::~EventLoop() {
+    stop();
+    for (int fd : {epollFd, timerFd, wakeFd}) {
+        if (fd >= 0) close(fd);
+    }
+}
+
+bool EventLoop::start(const string& threadName) {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd < 0 || timerFd < 0 || wakeFd < 0) {
+        cerr << "Event loop setup failed: " << strerror(errno) << endl;
+        return false;
+    }
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.u64 = TIMER_TAG;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, timerFd, &ev);
+    ev.data.u64 = WAKE_TAG;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev);
+
+    worker = thread(&EventLoop::loop, this, threadName);
+    return true;
+}
+
+void EventLoop::stop() {
+    if (!worker.joinable()) return;
+    stopping = true;
+    uint64_t one = 1;
+    if (write(wakeFd, &one, sizeof(one)) < 0) {
+        cerr << "Event loop wakeup failed: " << strerror(errno) << endl;
+    }
+    worker.join();
+}
+
+EventLoop::TaskId EventLoop::scheduleOnce(chrono::milliseconds delay, Task task) {
+    return addTimer(delay, Clock::duration::zero(), std::move(task));
+}
+
+EventLoop::TaskId EventLoop::schedulePeriodic(chrono::milliseconds period, Task task,
+                                              chrono::milliseconds firstDelay) {
+    return addTimer(firstDelay, max<Clock::duration>(period, chrono::milliseconds(1)), std::move(task));
+}
+
+EventLoop::TaskId EventLoop::addTimer(Clock::duration delay, Clock::duration period, Task task) {
+    lock_guard<mutex> lock(mtx);
+    TaskId id = nextId++;
+    timers[id] = Timer{period, make_shared<Task>(std::move(task))};
+    deadlines.push({Clock::now() + delay, id});
+    armTimer();
+    return id;
+}
+
+bool EventLoop::cancel(TaskId id) {
+    lock_guard<mutex> lock(mtx);
+    return timers.erase(id) > 0;
+}
+
+EventLoop::WatchId EventLoop::watch(int fd, uint32_t events, Handler handler) {
+    lock_guard<mutex> lock(mtx);
+    WatchId id = nextId++;
+    epoll_event ev = {};
+    ev.events = events;
+    ev.data.u64 = id;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) return 0;
+    watches[id] = Watch{fd, make_shared<Handler>(std::move(handler))};
+    return id;
+}
+
+void EventLoop::modify(WatchId id, uint32_t events) {
+    lock_guard<mutex> lock(mtx);
+    auto it = watches.find(id);
+    if (it == watches.end()) return;
+    epoll_event ev = {};
+    ev.events = events;
+    ev.data.u64 = id;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, it->second.fd, &ev);
+}
+
+void EventLoop::unwatch(WatchId id) {
+    lock_guard<mutex> lock(mtx);
+    auto it = watches.find(id);
+    if (it == watches.end()) return;
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, it->second.fd, nullptr);
+    watches.erase(it);
+}
+
+// Points the timerfd at the earliest live deadline, or disarms it
+void EventLoop::armTimer() {
+    while (!deadlines.empty() && timers.count(deadlines.top().id) == 0) deadlines.pop();
+    itimerspec spec = {};
+    if (!deadlines.empty()) {
+        auto ns = chrono::duration_cast<chrono::nanoseconds>(deadlines.top().when.time_since_epoch()).count();
+        spec.it_value.tv_sec = ns / 1000000000;
+        spec.it_value.tv_nsec = ns % 1000000000;
+        if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) spec.it_value.tv_nsec = 1; // 0 disarms
+    }
+    timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
+
+// Runs every task that is due, one at a time and without the lock held, so
+// tasks can schedule and cancel
+void EventLoop::runDueTimers() {
+    uint64_t expirations;
+    if (read(timerFd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) return;
+
+    unique_lock<mutex> lock(mtx);
+    while (!deadlines.empty() && !stopping) {
+        Deadline next = deadlines.top();
+        auto now = Clock::now();
+        if (next.when > now) break;
+        deadlines.pop();
+        auto it = timers.find(next.id);
+        if (it == timers.end()) continue; // Cancelled
+
+        shared_ptr<Task> task = it->second.task;
+        if (it->second.period > Clock::duration::zero()) {
+            Clock::time_point when = next.when + it->second.period;
+            if (when <= now) when = now + it->second.period;
+            deadlines.push({when, next.id});
+        } else {
+            timers.erase(it);
+        }
+
+        lock.unlock();
+        (*task)();
+        lock.lock();
+    }
+    armTimer();
+}
+
+void EventLoop::dispatch(WatchId id, uint32_t events) {
+    shared_ptr<Handler> handler;
+    {
+        lock_guard<mutex> lock(mtx);
+        auto it = watches.find(id);
+        if (it == watches.end()) return; // Unwatched earlier in this batch
+        handler = it->second.handler;
+    }
+    (*handler)(events);
+}
+
+void EventLoop::loop(string threadName) {
+    setCurrentThreadName(threadName);
+    epoll_event events[32];
+
+    while (true) {
+        int n = epoll_wait(epollFd, events, 32, -1);
+        if (n < 0 && errno != EINTR) break;
+
+        for (int i = 0; i < n; i++) {
+            uint64_t tag = events[i].data.u64;
+            if (tag == WAKE_TAG || stopping) return;
+            if (tag == TIMER_TAG) {
+                runDueTimers();
+            } else {
+                dispatch(tag, events[i].events);
+            }
+        }
+    }
+}
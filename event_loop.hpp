@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One thread that runs the app's periodic and one-shot housekeeping (metrics
+// sampling, connectivity probes, the log feed) and dispatches readiness on
+// the descriptors they watch. Deadlines are kept in a min-heap with a single
+// timerfd armed for the earliest, so the thread only wakes when something is
+// due, and stop() interrupts it through an eventfd at once.
+//
+// Tasks and handlers run on the loop thread and must not block. Registering
+// and cancelling are safe from any thread once the loop has started.
+class EventLoop {
+public:
+    using Task = std::function<void()>;
+    using Handler = std::function<void(uint32_t events)>; // epoll event bits
+    using TaskId = uint64_t;  // 0 is never a valid ID
+    using WatchId = uint64_t;
+
+    EventLoop();
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    // Returns false if the loop could not be set up
+    bool start(const std::string& threadName = "events");
+    // Returns without waiting for pending tasks; only a task already running
+    // is finished
+    void stop();
+
+    TaskId scheduleOnce(std::chrono::milliseconds delay, Task task);
+    // First run after firstDelay, then every period. A run that falls behind
+    // skips the missed periods rather than catching up.
+    TaskId schedulePeriodic(std::chrono::milliseconds period, Task task,
+                            std::chrono::milliseconds firstDelay = std::chrono::milliseconds(0));
+    // Returns false if the task already ran (one-shot) or was cancelled
+    bool cancel(TaskId id);
+
+    // Calls handler whenever fd is ready for events; returns 0 on failure.
+    // Unwatch before closing fd.
+    WatchId watch(int fd, uint32_t events, Handler handler);
+    // Changes the events a watch waits for
+    void modify(WatchId id, uint32_t events);
+    void unwatch(WatchId id);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Timer {
+        Clock::duration period; // Zero for one-shot tasks
+        std::shared_ptr<Task> task;
+    };
+
+    struct Deadline {
+        Clock::time_point when;
+        TaskId id;
+        bool operator>(const Deadline& other) const { return when > other.when; }
+    };
+
+    struct Watch {
+        int fd;
+        std::shared_ptr<Handler> handler;
+    };
+
+    TaskId addTimer(Clock::duration delay, Clock::duration period, Task task);
+    void armTimer(); // Caller holds mtx
+    void runDueTimers();
+    void dispatch(WatchId id, uint32_t events);
+    void loop(std::string threadName);
+
+    int epollFd = -1;
+    int timerFd = -1;
+    int wakeFd = -1;
+    std::thread worker;
+    std::atomic<bool> stopping{false};
+
+    std::mutex mtx;
+    std::map<TaskId, Timer> timers;
+    // Cancelled tasks stay queued until they reach the top
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> deadlines;
+    std::map<WatchId, Watch> watches;
+    uint64_t nextId = 1;
+};
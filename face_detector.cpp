@@ -0,0 +1,143 @@
+#include "face_detector.hpp"
+#include "dnn_detector.hpp"
+
+#include <iostream>
+
+using namespace std;
+using namespace cv;
+
+// Grouping tolerance detectMultiScale() uses internally
+static const double GROUP_EPS = 0.2;
+
+// Ranges per worker; more than one lets stealing smooth out estimate errors
+static const int RANGES_PER_WORKER = 2;
+
+bool parseDetectorBackend(const string& name, DetectorBackend& backend) {
+    if (name == "haar") backend = DetectorBackend::Haar;
+    else if (name == "lbp") backend = DetectorBackend::Lbp;
+    else if (name == "dnn") backend = DetectorBackend::Dnn;
+    else return false;
+    return true;
+}
+
+const char* detectorBackendName(DetectorBackend backend) {
+    switch (backend) {
+        case DetectorBackend::Haar: return "haar";
+        case DetectorBackend::Lbp: return "lbp";
+        case DetectorBackend::Dnn: return "dnn";
+    }
+    return "?";
+}
+
+void FaceDetector::detectBatch(vector<DetectionJob>& jobs, double scaleFactor, int minNeighbors) {
+    for (auto& job : jobs) {
+        detectMultiScale(job.gray, job.faces, scaleFactor, minNeighbors, job.minSize, job.maxSize);
+    }
+}
+
+unique_ptr<FaceDetector> createFaceDetector(const DetectorConfig& config, int threads) {
+    if (config.backend == DetectorBackend::Dnn) {
+        auto detector = make_unique<DnnFaceDetector>(config);
+        if (!detector->load()) return nullptr;
+        return detector;
+    }
+
+    string path = config.modelPath;
+    if (path.empty()) path = config.backend == DetectorBackend::Lbp ? LBP_CASCADE_PATH : HAAR_CASCADE_PATH;
+    auto detector = make_unique<CascadeDetector>(threads);
+    if (!detector->load(path)) {
+        cerr << "Error loading cascade file " << path << endl;
+        return nullptr;
+    }
+    return detector;
+}
+
+CascadeDetector::CascadeDetector(int threads) {
+    if (threads > 1) pool = make_unique<WorkStealingPool>(threads);
+    cascades.resize(this->threads() + (pool ? 1 : 0));
+}
+
+bool CascadeDetector::load(const string& cascadePath) {
+    for (auto& cascade : cascades) {
+        if (!cascade.load(cascadePath)) return false;
+    }
+    return true;
+}
+
+vector<CascadeDetector::LevelRange> CascadeDetector::planRanges(const Size& imageSize, double scaleFactor,
+                                                             const Size& minSize, const Size& maxSize) const {
+    struct Level {
+        Size window;
+        double cost;
+    };
+
+    // Replays the scale loop of CascadeClassifier::detectMultiScale so the
+    // levels, and the order factors accumulate in, are identical
+    Size original = cascades[0].getOriginalWindowSize();
+    Size maxObject = (maxSize.width == 0 || maxSize.height == 0) ? imageSize : maxSize;
+    vector<Level> levels;
+    double totalCost = 0.0;
+    for (double factor = 1; ; factor *= scaleFactor) {
+        Size window(cvRound(original.width * factor), cvRound(original.height * factor));
+        if (window.width > maxObject.width || window.height > maxObject.height ||
+            window.width > imageSize.width || window.height > imageSize.height) break;
+        if (window.width < minSize.width || window.height < minSize.height) continue;
+
+        // Cost is the number of window positions; levels past 2x scan every pixel
+        Size scaled(cvRound(imageSize.width / factor), cvRound(imageSize.height / factor));
+        int step = factor > 2.0 ? 1 : 2;
+        double cost = static_cast<double>(max(scaled.width + 1 - original.width, 0) / step + 1) *
+                      (max(scaled.height + 1 - original.height, 0) / step + 1);
+        levels.push_back({window, cost});
+        totalCost += cost;
+    }
+
+    vector<LevelRange> ranges;
+    if (levels.empty()) return ranges;
+
+    size_t target = min(levels.size(), static_cast<size_t>(threads() * RANGES_PER_WORKER));
+    double perRange = totalCost / target;
+    double accumulated = 0.0;
+    size_t first = 0;
+    for (size_t i = 0; i < levels.size(); i++) {
+        accumulated += levels[i].cost;
+        bool last = (i + 1 == levels.size());
+        // Levels that round to the same window cannot be told apart by size
+        // bounds, so never split between them
+        bool sameWindowNext = !last && levels[i + 1].window == levels[i].window;
+        if (last || (!sameWindowNext && accumulated >= perRange * (ranges.size() + 1))) {
+            ranges.push_back({levels[first].window, levels[i].window});
+            first = i + 1;
+        }
+    }
+
+    // The outer bounds are the caller's own, so levels at either end are
+    // covered exactly as a single call would cover them
+    ranges.front().minWindow = minSize;
+    ranges.back().maxWindow = maxSize;
+    return ranges;
+}
+
+void CascadeDetector::detectMultiScale(const Mat& gray, vector<Rect>& faces, double scaleFactor,
+                                       int minNeighbors, Size minSize, Size maxSize) {
+    faces.clear();
+    if (gray.empty() || scaleFactor <= 1.0) return;
+
+    vector<LevelRange> ranges = pool ? planRanges(gray.size(), scaleFactor, minSize, maxSize)
+                                     : vector<LevelRange>();
+    if (ranges.size() <= 1) {
+        cascades.back().detectMultiScale(gray, faces, scaleFactor, minNeighbors, 0, minSize, maxSize);
+        return;
+    }
+
+    vector<vector<Rect>> raw(ranges.size());
+    pool->run(ranges.size(), [&](size_t index, int worker) {
+        const LevelRange& range = ranges[index];
+        cascades[worker].detectMultiScale(gray, raw[index], scaleFactor, 0, 0, range.minWindow, range.maxWindow);
+    });
+
+    for (const auto& hits : raw) {
+        faces.insert(faces.end(), hits.begin(), hits.end());
+    }
+    groupRectangles(faces, minNeighbors, GROUP_EPS);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "thread_pool.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+static const char* const HAAR_CASCADE_PATH = "/usr/share/opencv4/haarcascades/haarcascade_frontalface_default.xml";
+static const char* const LBP_CASCADE_PATH = "/usr/share/opencv4/lbpcascades/lbpcascade_frontalface_improved.xml";
+// OpenCV's ResNet-10 face SSD, fetched separately (see README)
+static const char* const DNN_MODEL_PATH = "models/res10_300x300_ssd_iter_140000.caffemodel";
+static const char* const DNN_CONFIG_PATH = "models/deploy.prototxt";
+
+enum class DetectorBackend {
+    Haar, // Stock Haar cascade: the reference, and the slowest
+    Lbp,  // LBP cascade: integer features, several times cheaper, somewhat lower recall
+    Dnn   // SSD-style network through OpenCV's DNN module on the CPU
+};
+
+struct DetectorConfig {
+    DetectorBackend backend = DetectorBackend::Haar;
+    std::string modelPath;           // Cascade XML or network weights, empty = the backend's default
+    std::string configPath;          // Network description (e.g. a .prototxt), if the weights need one
+    cv::Size inputSize = cv::Size(300, 300); // Network input
+    float confidence = 0.5f;         // Minimum network score for a face
+};
+
+bool parseDetectorBackend(const std::string& name, DetectorBackend& backend);
+const char* detectorBackendName(DetectorBackend backend);
+
+// One image for a batched detection call, with its face size limits
+struct DetectionJob {
+    cv::Mat gray;
+    cv::Size minSize;
+    cv::Size maxSize;             // Empty = no limit
+    std::vector<cv::Rect> faces;  // Output
+};
+
+// Face detector backend. One instance serves one calling thread at a time.
+class FaceDetector {
+public:
+    virtual ~FaceDetector() = default;
+
+    // Cascade semantics; network backends ignore scaleFactor and minNeighbors
+    // and filter their boxes by size instead
+    virtual void detectMultiScale(const cv::Mat& gray, std::vector<cv::Rect>& faces, double scaleFactor,
+                                  int minNeighbors, cv::Size minSize, cv::Size maxSize = cv::Size()) = 0;
+
+    // Several images at once, e.g. every tracked region of a frame. Backends
+    // that can batch run them in one pass; the rest go one by one.
+    virtual void detectBatch(std::vector<DetectionJob>& jobs, double scaleFactor, int minNeighbors);
+
+    virtual int threads() const { return 1; }
+};
+
+// Builds and loads a backend; returns nullptr (after logging why) if its model
+// cannot be loaded. threads is the pyramid parallelism of cascade backends.
+std::unique_ptr<FaceDetector> createFaceDetector(const DetectorConfig& config, int threads = 1);
+
+// Multi-scale cascade detector, Haar or LBP, that spreads the image pyramid
+// across a work-stealing pool. The stock scale sequence is split into
+// contiguous window-size ranges of roughly equal cost. Each range is scanned by
+// its own cascade instance without grouping, and the raw hits are merged with
+// the same groupRectangles() call detectMultiScale() makes, so results match
+// the single-call version exactly.
+class CascadeDetector : public FaceDetector {
+public:
+    // threads <= 1 runs every scan inline on the calling thread
+    explicit CascadeDetector(int threads = 1);
+
+    bool load(const std::string& cascadePath);
+
+    // Same contract and results as CascadeClassifier::detectMultiScale
+    void detectMultiScale(const cv::Mat& gray, std::vector<cv::Rect>& faces, double scaleFactor,
+                          int minNeighbors, cv::Size minSize, cv::Size maxSize = cv::Size()) override;
+
+    int threads() const override { return pool ? pool->size() : 1; }
+
+private:
+    // Window sizes of one contiguous run of pyramid levels
+    struct LevelRange {
+        cv::Size minWindow;
+        cv::Size maxWindow;
+    };
+
+    std::vector<LevelRange> planRanges(const cv::Size& imageSize, double scaleFactor,
+                                       const cv::Size& minSize, const cv::Size& maxSize) const;
+
+    std::vector<cv::CascadeClassifier> cascades; // One per pool worker, plus one for inline scans
+    std::unique_ptr<WorkStealingPool> pool;
+};
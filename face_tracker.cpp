@@ -0,0 +1,295 @@
+#include "face_tracker.hpp"
+#include "face_detector.hpp"
+#include "frame_pool.hpp"
+#include "kernel_log.hpp"
+#include "motion_gate.hpp"
+#include "multi_tracker.hpp"
+#include "snapshot_writer.hpp"
+#include "stage_metrics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+using namespace cv;
+
+// Face detection tracking
+static const int COOLDOWN_SECONDS = 5;
+static const int DETECTION_WINDOW_SECONDS = 1;
+static const float DUPLICATE_IOU = 0.5f; // Same face found by two overlapping regions
+static const size_t RECENT_HASHES_SEEDED = 64; // Captures of the previous run checked for duplicates
+
+double calculateRectDistance(const Rect& rect1, const Rect& rect2) {
+    Point center1(rect1.x + rect1.width/2, rect1.y + rect1.height/2);
+    Point center2(rect2.x + rect2.width/2, rect2.y + rect2.height/2);
+    return sqrt(pow(center1.x - center2.x, 2) + pow(center1.y - center2.y, 2));
+}
+
+// Converts to gray at the detection scale, starting from the native luma when
+// there is one. detectGray may share the pixels of gray or luma, which is
+// never written to.
+static void prepareGray(const Mat& frame, const Mat& luma, Mat& gray, Mat& detectGray,
+                        const DetectionParams& params) {
+    ScopedStageTimer timer(Stage::Grayscale);
+    CV_Assert(luma.empty() || luma.size() == frame.size());
+    const Mat* source = &luma;
+    if (luma.empty()) {
+        cvtColor(frame, gray, COLOR_BGR2GRAY);
+        source = &gray;
+    }
+    if (params.downscale < 1.0) {
+        attachFramePool(detectGray);
+        resize(*source, detectGray, Size(), params.downscale, params.downscale, INTER_AREA);
+    } else {
+        detectGray = *source;
+    }
+}
+
+// One region to scan, in frame pixels, and the faces found in it
+struct RegionScan {
+    Rect region;
+    Size minSize;
+    Size maxSize;
+    vector<Rect> faces;
+};
+
+// Scans regions of the detection-scale image in one detector batch and maps
+// hits back to frame pixels
+static void scanRegions(FaceDetector& detector, const Mat& detectGray, vector<RegionScan>& scans,
+                        const DetectionParams& params) {
+    double scale = params.downscale < 1.0 ? params.downscale : 1.0;
+    auto toDetect = [scale](int v) { return static_cast<int>(lround(v * scale)); };
+    auto toFrame = [scale](int v) { return static_cast<int>(lround(v / scale)); };
+
+    vector<DetectionJob> jobs;
+    vector<Rect> offsets;
+    vector<size_t> owners;
+    for (size_t i = 0; i < scans.size(); i++) {
+        const RegionScan& scan = scans[i];
+        Rect scaled = Rect(toDetect(scan.region.x), toDetect(scan.region.y),
+                           toDetect(scan.region.width), toDetect(scan.region.height))
+                      & Rect(0, 0, detectGray.cols, detectGray.rows);
+        if (scaled.empty()) continue;
+
+        DetectionJob job;
+        job.gray = detectGray(scaled);
+        job.minSize = Size(toDetect(scan.minSize.width), toDetect(scan.minSize.height));
+        if (!scan.maxSize.empty()) job.maxSize = Size(toDetect(scan.maxSize.width), toDetect(scan.maxSize.height));
+        jobs.push_back(std::move(job));
+        offsets.push_back(scaled);
+        owners.push_back(i);
+    }
+
+    {
+        ScopedStageTimer timer(Stage::Detect);
+        detector.detectBatch(jobs, params.scaleFactor, params.minNeighbors);
+    }
+    for (auto& scan : scans) scan.faces.clear();
+    for (size_t j = 0; j < jobs.size(); j++) {
+        for (const Rect& face : jobs[j].faces) {
+            scans[owners[j]].faces.emplace_back(toFrame(face.x + offsets[j].x), toFrame(face.y + offsets[j].y),
+                                                toFrame(face.width), toFrame(face.height));
+        }
+    }
+}
+
+void detectFaces(FaceDetector& detector, const Mat& frame, const Mat& luma, Mat& gray, vector<Rect>& faces,
+                 const DetectionParams& params) {
+    Mat detectGray;
+    prepareGray(frame, luma, gray, detectGray, params);
+    vector<RegionScan> scans(1);
+    scans[0].region = Rect(0, 0, frame.cols, frame.rows);
+    scans[0].minSize = params.minSize;
+    scans[0].maxSize = params.maxSize;
+    scanRegions(detector, detectGray, scans, params);
+    faces.swap(scans[0].faces);
+}
+
+void detectTrackedFaces(FaceDetector& detector, MultiFaceTracker& tracker,
+                        const Mat& frame, const Mat& luma, Mat& gray, uint64_t seq,
+                        chrono::steady_clock::time_point now, const DetectionParams& params, MotionGate* gate) {
+    vector<Rect> regions = tracker.searchRegions(frame.size(), seq);
+    vector<Rect> faces;
+
+    // A sweep the gate narrows down scans the moving regions at any face size.
+    // It only stands in for the search for new faces: tracked faces are still
+    // looked for around their tracks, moving or not.
+    vector<Rect> moving;
+    MotionGate::Sweep sweep = MotionGate::Sweep::Full;
+    if (regions.empty() && gate) {
+        sweep = gate->planSweep(now, moving);
+        if (sweep != MotionGate::Sweep::Full) regions = tracker.trackRegions(frame.size(), seq);
+    }
+
+    if (regions.empty() && sweep == MotionGate::Sweep::Full) {
+        detectFaces(detector, frame, luma, gray, faces, params);
+    } else if (regions.empty() && moving.empty()) {
+        // Static scene and nothing tracked; the tracker still ages out its tracks
+    } else {
+        // Only look around the tracked faces, at sizes close to theirs, or
+        // where something moved, all in one batch
+        Mat detectGray;
+        prepareGray(frame, luma, gray, detectGray, params);
+        vector<RegionScan> scans(regions.size() + moving.size());
+        for (size_t i = 0; i < regions.size(); i++) {
+            const Rect& region = regions[i];
+            scans[i].region = region;
+            scans[i].minSize = Size(max(params.minSize.width, region.width / 4),
+                                    max(params.minSize.height, region.height / 4));
+            scans[i].maxSize = region.size();
+            if (!params.maxSize.empty()) {
+                scans[i].maxSize = Size(min(region.width, params.maxSize.width),
+                                        min(region.height, params.maxSize.height));
+            }
+        }
+        for (size_t i = 0; i < moving.size(); i++) {
+            RegionScan& scan = scans[regions.size() + i];
+            scan.region = moving[i];
+            scan.minSize = params.minSize;
+            scan.maxSize = params.maxSize;
+        }
+        scanRegions(detector, detectGray, scans, params);
+        for (const auto& scan : scans) {
+            for (const Rect& face : scan.faces) {
+                bool duplicate = any_of(faces.begin(), faces.end(), [&](const Rect& other) {
+                    float inter = (face & other).area();
+                    return inter / (face.area() + other.area() - inter) > DUPLICATE_IOU;
+                });
+                if (!duplicate) faces.push_back(face);
+            }
+        }
+    }
+
+    tracker.update(faces, seq, now);
+}
+
+FaceTracker::FaceTracker(string snapshotDir, SnapshotNaming naming, bool hudLogs, SnapshotWriter& writer,
+                         const SnapshotDedupConfig& dedup)
+    : snapshotDir(std::move(snapshotDir)), naming(naming), hudLogs(hudLogs), writer(writer), dedup(dedup) {
+    // Offline runs rewrite their whole directory, so they start a fresh index.
+    // Live ones pick up where the last run left off, including its recent faces.
+    bool live = naming == SnapshotNaming::Timestamp;
+    index = SnapshotIndex::open(this->snapshotDir, live ? SnapshotClock::Wall : SnapshotClock::Media);
+    SnapshotIndexView previous;
+    if (live && index && previous.open(this->snapshotDir)) {
+        size_t first = previous.size() > RECENT_HASHES_SEEDED ? previous.size() - RECENT_HASHES_SEEDED : 0;
+        for (size_t i = first; i < previous.size(); i++) recentHashes.add(previous[i].hash, previous[i].timeUs);
+    }
+}
+
+void FaceTracker::log(const string& message, int severity) {
+    if (hudLogs) addKernelLog(message, severity);
+}
+
+bool FaceTracker::saveSnapshot(const Mat& cleanFrame, const FaceTrack& track,
+                               chrono::steady_clock::time_point now, uint64_t seq) {
+    // Live captures are stamped with the wall clock, offline ones with media time
+    auto captureTime = naming == SnapshotNaming::Timestamp ? chrono::system_clock::now().time_since_epoch()
+                                                           : now.time_since_epoch();
+    SnapshotRecord record;
+    record.timeUs = chrono::duration_cast<chrono::microseconds>(captureTime).count();
+    record.seq = seq;
+    record.trackId = track.id;
+
+    // A track predicted fully off-frame leaves no face to hash, so the frame
+    // is saved without a dedup check or an index record
+    Rect box = track.predict(seq) & Rect(0, 0, cleanFrame.cols, cleanFrame.rows);
+    bool located = !box.empty();
+    if (located) {
+        record.hash = differenceHash(cleanFrame, box);
+        record.x = box.x;
+        record.y = box.y;
+        record.width = box.width;
+        record.height = box.height;
+    }
+
+    // The same person standing in view would otherwise be saved again after
+    // every cooldown
+    int64_t windowUs = static_cast<int64_t>(dedup.windowSeconds) * 1000000;
+    if (located && dedup.maxDistance >= 0 &&
+        recentHashes.contains(record.hash, record.timeUs, dedup.maxDistance, windowUs)) {
+        duplicates++;
+        log("Known subject, capture skipped", 1);
+        return false;
+    }
+
+    string tag;
+    if (naming == SnapshotNaming::Timestamp) {
+        tag = getCurrentDateTime();
+        replace(tag.begin(), tag.end(), ' ', '_');
+        replace(tag.begin(), tag.end(), ':', '_');
+    } else {
+        stringstream ss;
+        ss << setw(6) << setfill('0') << seq;
+        tag = ss.str();
+    }
+
+    // Clear all logs and add target acquisition messages when picture is taken.
+    // This happens before queueing so the writer's own "Image captured" report
+    // cannot be wiped out by the clear.
+    if (hudLogs) clearKernelLogs();
+    log("Analysis in progress", 3);
+    log("Processing data", 3);
+    log("Scan in progress", 3);
+    log("Searching database", 3);
+
+    // Encoding and the disk write happen on the writer pool, which reports the
+    // outcome to the log when it is done
+    if (!writer.submit(cleanFrame, snapshotDir + "/face_detected_" + tag, hudLogs,
+                       located ? index : nullptr, record)) {
+        log("Capture dropped", 2);
+        return false;
+    }
+    if (located) recentHashes.add(record.hash, record.timeUs);
+    snapshots++;
+    pictureTaken = true;
+    return true;
+}
+
+bool FaceTracker::update(const vector<FaceTrack>& tracks, const Mat& cleanFrame,
+                         chrono::steady_clock::time_point now, uint64_t seq) {
+    bool submitted = false;
+
+    if (isInCooldown) {
+        auto cooldownElapsed = chrono::duration_cast<chrono::seconds>(now - lastCaptureTimePoint).count();
+        if (cooldownElapsed >= COOLDOWN_SECONDS) {
+            isInCooldown = false;
+            if (pictureTaken) {
+                log("Analysis complete", 0);
+                pictureTaken = false;
+            }
+        }
+    }
+
+    // Track IDs only grow, so anything above the newest one seen is a new subject
+    for (const auto& track : tracks) {
+        if (track.id <= newestTrackId) continue;
+        newestTrackId = track.id;
+        if (faceDetected) {
+            log("New subject detected", 2);
+        } else {
+            faceDetected = true;
+            log("Human subject detected in frame", 0);
+        }
+    }
+
+    if (tracks.empty() && faceDetected) {
+        log("Subject lost from view", 1);
+        faceDetected = false;
+    }
+
+    // Capture a subject shortly after its track appears. The cooldown outlasts
+    // the detection window, so each track is captured at most once.
+    for (const auto& track : tracks) {
+        auto trackAge = chrono::duration_cast<chrono::seconds>(now - track.firstSeen).count();
+        if (!isInCooldown && trackAge <= DETECTION_WINDOW_SECONDS) {
+            submitted |= saveSnapshot(cleanFrame, track, now, seq);
+            lastCaptureTimePoint = now;
+            isInCooldown = true;
+        }
+    }
+
+    return submitted;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "snapshot_index.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class FaceDetector;
+class MotionGate;
+class MultiFaceTracker;
+class SnapshotWriter;
+struct FaceTrack;
+
+double calculateRectDistance(const cv::Rect& rect1, const cv::Rect& rect2);
+
+// Cascade settings for detection passes. The defaults are the stock values.
+struct DetectionParams {
+    int interval = 3;                    // Run detection on every Nth frame
+    double downscale = 1.0;              // Detection input size relative to the frame
+    double scaleFactor = 1.1;            // Pyramid scale step
+    int minNeighbors = 4;
+    cv::Size minSize = cv::Size(30, 30); // In frame pixels
+    cv::Size maxSize;                    // In frame pixels, empty = no limit
+};
+
+// Runs the cascade over a whole 640x480 BGR frame. luma, if not empty, is the
+// frame's own gray plane and replaces converting frame into gray.
+void detectFaces(FaceDetector& detector, const cv::Mat& frame, const cv::Mat& luma, cv::Mat& gray,
+                 std::vector<cv::Rect>& faces, const DetectionParams& params = DetectionParams());
+
+// One detection pass on frame `seq`: scans the regions the tracker asks for (or
+// the whole frame on sweep passes) and folds the faces found into the tracks.
+// With a motion gate, sweeps only cover what moved and are skipped on a static
+// scene; the gate must already have been updated with this frame.
+void detectTrackedFaces(FaceDetector& detector, MultiFaceTracker& tracker,
+                        const cv::Mat& frame, const cv::Mat& luma, cv::Mat& gray, uint64_t seq,
+                        std::chrono::steady_clock::time_point now,
+                        const DetectionParams& params = DetectionParams(), MotionGate* gate = nullptr);
+
+// How snapshot files are named
+enum class SnapshotNaming {
+    Timestamp, // face_detected_<date>_<time>.jpg, for live cameras
+    FrameIndex // face_detected_<frame>.jpg, for offline inputs
+};
+
+// Per-stream capture state machine driven by the face tracks. Each detection
+// pass is fed in with the time it was taken, so offline inputs can run on
+// media time. A capture whose face crop hashes close to a recent one is
+// skipped; saved snapshots are recorded in the directory's snapshot index.
+class FaceTracker {
+public:
+    FaceTracker(std::string snapshotDir, SnapshotNaming naming, bool hudLogs, SnapshotWriter& writer,
+                const SnapshotDedupConfig& dedup = SnapshotDedupConfig());
+
+    // Returns true if cleanFrame was handed to the snapshot writer. It is shared,
+    // not copied, so the caller must not write to that buffer again.
+    bool update(const std::vector<FaceTrack>& tracks, const cv::Mat& cleanFrame,
+                std::chrono::steady_clock::time_point now, uint64_t seq);
+
+    // Safe to read from other threads
+    bool isFaceDetected() const { return faceDetected; }
+    bool isPictureTaken() const { return pictureTaken; }
+    int snapshotCount() const { return snapshots; }
+    int duplicateCount() const { return duplicates; }
+
+private:
+    void log(const std::string& message, int severity);
+    bool saveSnapshot(const cv::Mat& cleanFrame, const FaceTrack& track,
+                      std::chrono::steady_clock::time_point now, uint64_t seq);
+
+    std::string snapshotDir;
+    SnapshotNaming naming;
+    bool hudLogs;
+    SnapshotWriter& writer;
+    SnapshotDedupConfig dedup;
+    std::shared_ptr<SnapshotIndex> index; // Null if the index could not be opened
+    RecentHashes recentHashes;
+
+    std::atomic<bool> faceDetected{false};
+    std::atomic<bool> pictureTaken{false};
+    std::atomic<int> snapshots{0};
+    std::atomic<int> duplicates{0};
+    std::chrono::steady_clock::time_point lastCaptureTimePoint;
+    bool isInCooldown = false;
+    int newestTrackId = 0;
+};
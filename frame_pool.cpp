@@ -0,0 +1,115 @@
+#include "frame_pool.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+using namespace cv;
+
+struct FramePool::Slot {
+    alignas(UMatData) unsigned char header[sizeof(UMatData)];
+    uchar* buffer = nullptr;
+    size_t size = 0;
+    Slot* nextFree = nullptr;
+    Slot* nextSlot = nullptr;
+};
+
+FramePool::~FramePool() {
+    // Only reached for pools other than the process-wide one, once their Mats are gone
+    while (slots) {
+        Slot* slot = slots;
+        slots = slot->nextSlot;
+        free(slot->buffer);
+        delete slot;
+    }
+}
+
+UMatData* FramePool::allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                              AccessFlag flags, UMatUsageFlags usageFlags) const {
+    // Headers over caller memory have nothing to recycle
+    if (data) return Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; i--) {
+        if (step) step[i] = total;
+        total *= sizes[i];
+    }
+
+    Slot* slot = nullptr;
+    {
+        lock_guard<mutex> lock(mtx);
+        SizeClass* sizeClass = nullptr;
+        for (size_t i = 0; i < classCount && !sizeClass; i++) {
+            if (classes[i].size == total) sizeClass = &classes[i];
+        }
+        if (!sizeClass && classCount < MAX_SIZES) {
+            sizeClass = &classes[classCount++];
+            sizeClass->size = total;
+        }
+        if (!sizeClass) {
+            fallbacks.fetch_add(1, memory_order_relaxed);
+        } else if (sizeClass->free) {
+            slot = sizeClass->free;
+            sizeClass->free = slot->nextFree;
+            reuses.fetch_add(1, memory_order_relaxed);
+        } else {
+            size_t rounded = (max<size_t>(total, 1) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+            uchar* buffer = static_cast<uchar*>(aligned_alloc(ALIGNMENT, rounded));
+            if (!buffer) CV_Error(Error::StsNoMem, "Frame pool is out of memory");
+            slot = new Slot;
+            slot->buffer = buffer;
+            slot->size = total;
+            slot->nextSlot = slots;
+            slots = slot;
+            buffers.fetch_add(1, memory_order_relaxed);
+            bytes.fetch_add(total, memory_order_relaxed);
+        }
+    }
+    if (!slot) return Mat::getStdAllocator()->allocate(dims, sizes, type, nullptr, step, flags, usageFlags);
+
+    UMatData* u = new (slot->header) UMatData(this);
+    u->data = u->origdata = slot->buffer;
+    u->size = total;
+    u->userdata = slot;
+    return u;
+}
+
+bool FramePool::allocate(UMatData* data, AccessFlag, UMatUsageFlags) const {
+    return data != nullptr;
+}
+
+void FramePool::deallocate(UMatData* u) const {
+    if (!u) return;
+    CV_Assert(u->urefcount == 0 && u->refcount == 0);
+    Slot* slot = static_cast<Slot*>(u->userdata);
+    u->~UMatData();
+
+    lock_guard<mutex> lock(mtx);
+    for (size_t i = 0; i < classCount; i++) {
+        if (classes[i].size == slot->size) {
+            slot->nextFree = classes[i].free;
+            classes[i].free = slot;
+            return;
+        }
+    }
+}
+
+FramePool::Stats FramePool::stats() const {
+    Stats s;
+    s.buffers = buffers.load(memory_order_relaxed);
+    s.bytes = bytes.load(memory_order_relaxed);
+    s.reuses = reuses.load(memory_order_relaxed);
+    s.fallbacks = fallbacks.load(memory_order_relaxed);
+    return s;
+}
+
+FramePool& framePool() {
+    static FramePool* pool = new FramePool;
+    return *pool;
+}
+
+void attachFramePool(Mat& mat) {
+    mat.release();
+    mat.allocator = &framePool();
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+// Recycling allocator for frame-sized Mat buffers. A Mat that uses it gets a
+// 64-byte-aligned buffer from a free list of the same byte size, and hands it
+// back when its last reference goes away, so capture, resize and colour
+// conversion stop going to the heap once every size in flight has been seen.
+// Sharing stays Mat's own ref-counting: copies of a pooled Mat share one buffer.
+//
+// Only exact sizes are recycled and at most MAX_SIZES distinct ones are
+// tracked; anything else falls back to OpenCV's standard allocator.
+class FramePool : public cv::MatAllocator {
+public:
+    struct Stats {
+        uint64_t buffers = 0;   // Buffers created, in use or free
+        uint64_t bytes = 0;     // Their total size
+        uint64_t reuses = 0;    // Allocations served from a free list
+        uint64_t fallbacks = 0; // Allocations passed to the standard allocator
+    };
+
+    FramePool() = default;
+    ~FramePool() override;
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override;
+    bool allocate(cv::UMatData* data, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const override;
+    void deallocate(cv::UMatData* data) const override;
+
+    Stats stats() const;
+
+private:
+    static const size_t ALIGNMENT = 64;
+    static const size_t MAX_SIZES = 16;
+
+    // A buffer plus the header OpenCV tracks it by, kept together so
+    // recycling needs no allocation at all
+    struct Slot;
+
+    struct SizeClass {
+        size_t size = 0;
+        Slot* free = nullptr;
+    };
+
+    mutable std::mutex mtx;
+    mutable SizeClass classes[MAX_SIZES];
+    mutable size_t classCount = 0;
+    mutable Slot* slots = nullptr; // Every slot ever created, for the destructor
+    mutable std::atomic<uint64_t> buffers{0};
+    mutable std::atomic<uint64_t> bytes{0};
+    mutable std::atomic<uint64_t> reuses{0};
+    mutable std::atomic<uint64_t> fallbacks{0};
+};
+
+// Process-wide pool; never destroyed, so Mats with static lifetime stay safe
+FramePool& framePool();
+
+// Empties mat and makes its next allocation come from the frame pool. Anything
+// that (re)creates the Mat through create(), as capture reads and most OpenCV
+// functions do for their outputs, then recycles pool buffers.
+void attachFramePool(cv::Mat& mat);
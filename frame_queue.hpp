@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// What push() does when the consumer has fallen behind
+enum class QueuePolicy {
+    DropOldest, // Overwrite the oldest queued item and count it as dropped
+    Block       // Wait for the consumer to make room
+};
+
+// Bounded single-producer/single-consumer ring buffer connecting two pipeline stages
+template <typename T>
+class FrameQueue {
+public:
+    FrameQueue(size_t capacity, QueuePolicy policy)
+        : slots(capacity > 0 ? capacity : 1), policy(policy) {}
+
+    FrameQueue(const FrameQueue&) = delete;
+    FrameQueue& operator=(const FrameQueue&) = delete;
+
+    // Returns false once the queue has been closed
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mtx);
+        if (policy == QueuePolicy::Block) {
+            notFull.wait(lock, [this] { return closed || count < slots.size(); });
+        }
+        if (closed) return false;
+
+        if (count == slots.size()) {
+            // Make room by discarding the oldest entry
+            head = (head + 1) % slots.size();
+            count--;
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        slots[(head + count) % slots.size()] = std::move(item);
+        count++;
+        depth.store(count, std::memory_order_relaxed);
+        lock.unlock();
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // Blocks until an item is available; returns false when closed and drained
+    bool pop(T& out) {
+        std::unique_lock<std::mutex> lock(mtx);
+        notEmpty.wait(lock, [this] { return closed || count > 0; });
+        return takeLocked(out, lock);
+    }
+
+    // Like pop(), but gives up after the timeout
+    template <typename Rep, typename Period>
+    bool popFor(T& out, const std::chrono::duration<Rep, Period>& timeout) {
+        std::unique_lock<std::mutex> lock(mtx);
+        notEmpty.wait_for(lock, timeout, [this] { return closed || count > 0; });
+        return takeLocked(out, lock);
+    }
+
+    bool tryPop(T& out) {
+        std::unique_lock<std::mutex> lock(mtx);
+        return takeLocked(out, lock);
+    }
+
+    // Wakes both sides; pending items can still be popped
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            closed = true;
+        }
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+    bool isClosed() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return closed;
+    }
+
+    // Lock-free readouts for the HUD
+    size_t size() const { return depth.load(std::memory_order_relaxed); }
+    size_t capacity() const { return slots.size(); }
+    uint64_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    bool takeLocked(T& out, std::unique_lock<std::mutex>& lock) {
+        if (count == 0) return false;
+        out = std::move(slots[head]);
+        slots[head] = T();
+        head = (head + 1) % slots.size();
+        count--;
+        depth.store(count, std::memory_order_relaxed);
+        lock.unlock();
+        notFull.notify_one();
+        return true;
+    }
+
+    std::vector<T> slots;
+    const QueuePolicy policy;
+    mutable std::mutex mtx;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    size_t head = 0;
+    size_t count = 0;
+    bool closed = false;
+    std::atomic<size_t> depth{0};
+    std::atomic<uint64_t> dropped{0};
+};
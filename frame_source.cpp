@@ -0,0 +1,145 @@
+#include "frame_source.hpp"
+#include "v4l2_source.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <map>
+
+using namespace std;
+using namespace cv;
+namespace fs = std::filesystem;
+
+// Image directories carry no timing, so treat them as a 30 FPS stream
+static const double DEFAULT_FPS = 30.0;
+
+class VideoCaptureSource : public FrameSource {
+public:
+    VideoCaptureSource(string name, VideoCapture&& capture, bool live)
+        : FrameSource(std::move(name)), capture(std::move(capture)), live(live) {}
+
+    ~VideoCaptureSource() override { capture.release(); }
+
+    bool read(Mat& frame) override {
+        return capture.read(frame) && !frame.empty();
+    }
+
+    double fps() const override {
+        double value = capture.get(CAP_PROP_FPS);
+        return value > 0 ? value : DEFAULT_FPS;
+    }
+
+    bool isLive() const override { return live; }
+
+private:
+    VideoCapture capture;
+    bool live;
+};
+
+class ImageDirSource : public FrameSource {
+public:
+    ImageDirSource(string name, vector<string> files)
+        : FrameSource(std::move(name)), files(std::move(files)) {}
+
+    bool read(Mat& frame) override {
+        // Skip unreadable files rather than ending the stream
+        while (next < files.size()) {
+            frame = imread(files[next++], IMREAD_COLOR);
+            if (!frame.empty()) return true;
+            cerr << "Skipping unreadable image: " << files[next - 1] << endl;
+        }
+        return false;
+    }
+
+    double fps() const override { return DEFAULT_FPS; }
+
+private:
+    vector<string> files;
+    size_t next = 0;
+};
+
+static bool isImageFile(const fs::path& path) {
+    static const vector<string> extensions = {".jpg", ".jpeg", ".png", ".bmp", ".ppm", ".pgm", ".tif", ".tiff", ".webp"};
+    string ext = path.extension().string();
+    transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return find(extensions.begin(), extensions.end(), ext) != extensions.end();
+}
+
+unique_ptr<FrameSource> openCameraSource(int index, bool native) {
+    if (native) {
+        auto source = openV4l2Source(index, Size(640, 480), 30);
+        if (source) return source;
+    }
+
+    VideoCapture capture;
+    capture.open(index, CAP_V4L2); // Use V4L2 backend explicitly
+    if (!capture.isOpened()) {
+        cerr << "Error opening video stream! Trying fallback..." << endl;
+        capture.open(index); // Fallback to default
+        if (!capture.isOpened()) {
+            cerr << "Failed to open camera!" << endl;
+            return nullptr;
+        }
+    }
+
+    // Set camera properties
+    capture.set(CAP_PROP_FPS, 30);
+    capture.set(CAP_PROP_FRAME_WIDTH, 640);
+    capture.set(CAP_PROP_FRAME_HEIGHT, 480);
+
+    return make_unique<VideoCaptureSource>("camera" + to_string(index), std::move(capture), true);
+}
+
+unique_ptr<FrameSource> openInputSource(const string& path) {
+    fs::path inputPath(path);
+    error_code ec;
+
+    if (fs::is_directory(inputPath, ec)) {
+        vector<string> files;
+        for (const auto& entry : fs::directory_iterator(inputPath, ec)) {
+            if (entry.is_regular_file() && isImageFile(entry.path())) {
+                files.push_back(entry.path().string());
+            }
+        }
+        if (files.empty()) {
+            cerr << "No images found in " << path << endl;
+            return nullptr;
+        }
+        sort(files.begin(), files.end());
+
+        return make_unique<ImageDirSource>(inputSourceName(path), std::move(files));
+    }
+
+    if (isRawYuvFile(path)) return openRawYuvSource(path);
+
+    VideoCapture capture(path);
+    if (!capture.isOpened()) {
+        cerr << "Failed to open input: " << path << endl;
+        return nullptr;
+    }
+    return make_unique<VideoCaptureSource>(inputSourceName(path), std::move(capture), false);
+}
+
+unique_ptr<FrameSource> openStreamSource(const string& spec, bool nativeCamera) {
+    bool device = !spec.empty() && all_of(spec.begin(), spec.end(), ::isdigit);
+    return device ? openCameraSource(stoi(spec), nativeCamera) : openInputSource(spec);
+}
+
+string inputSourceName(const string& path) {
+    fs::path inputPath(path);
+    if (!inputPath.has_filename()) inputPath = inputPath.parent_path(); // Trailing slash
+    error_code ec;
+    string name = fs::is_directory(inputPath, ec) ? inputPath.filename().string()
+                                                  : inputPath.stem().string();
+    return name.empty() ? "input" : name;
+}
+
+vector<string> uniqueSourceNames(const vector<string>& names) {
+    vector<string> unique;
+    map<string, int> counts;
+    for (const auto& name : names) {
+        int count = ++counts[name];
+        unique.push_back(count == 1 ? name : name + "_" + to_string(count));
+    }
+    return unique;
+}
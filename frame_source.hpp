@@ -0,0 +1,65 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 8-bit luma plane of a frame, from sources that capture YUV natively. The
+// pixels may live in a driver buffer or a file mapping and are read-only;
+// keeper holds that memory (and a camera buffer) until the last copy is gone.
+struct LumaPlane {
+    cv::Mat gray;
+    std::shared_ptr<void> keeper;
+};
+
+// Anything frames can be pulled from: a live camera, a video file or a
+// directory of still images
+class FrameSource {
+public:
+    virtual ~FrameSource() = default;
+
+    // Returns false when the source is exhausted or fails
+    virtual bool read(cv::Mat& frame) = 0;
+
+    // Also hands out the frame's luma, at the frame's size, when the source has
+    // it without converting from BGR; otherwise luma is left empty
+    virtual bool readWithLuma(cv::Mat& frame, LumaPlane& luma) {
+        luma = LumaPlane();
+        return read(frame);
+    }
+
+    // Nominal frame rate, used to derive media time for offline inputs
+    virtual double fps() const = 0;
+
+    // Live sources deliver frames in real time; recorded ones must be paced
+    // by whoever wants to play them back at their nominal rate
+    virtual bool isLive() const { return false; }
+
+    // Short name for logs and per-input snapshot directories
+    const std::string& name() const { return sourceName; }
+
+protected:
+    explicit FrameSource(std::string name) : sourceName(std::move(name)) {}
+
+private:
+    std::string sourceName;
+};
+
+// Opens a camera at 640x480@30: natively through V4L2 when it offers YUYV or
+// NV12 (unless native is false), else through OpenCV's V4L2 backend, falling
+// back to the default backend
+std::unique_ptr<FrameSource> openCameraSource(int index, bool native = true);
+
+// Opens a video file, a raw .yuyv/.nv12 file, or a directory of images read in
+// name order
+std::unique_ptr<FrameSource> openInputSource(const std::string& path);
+
+// Opens a camera for an all-digit spec ("0", "2"), otherwise a file or directory
+std::unique_ptr<FrameSource> openStreamSource(const std::string& spec, bool nativeCamera = true);
+
+// Name openInputSource() gives a path: the directory name or the file stem
+std::string inputSourceName(const std::string& path);
+
+// Distinct names for a set of sources, suffixing repeats with _2, _3, ...
+std::vector<std::string> uniqueSourceNames(const std::vector<std::string>& names);
@@ -0,0 +1,157 @@
+#include "http_listener.hpp"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const size_t MAX_REQUEST_SIZE = 4096;
+static const int REQUEST_TIMEOUT_MS = 2000;
+static const int SWEEP_INTERVAL_MS = 500;
+static const uint32_t INPUT_EVENTS = EPOLLIN | EPOLLRDHUP;
+
+HttpListener::HttpListener(EventLoop& loop, RequestHandler onRequest, ConnectionHandler onWritable,
+                           ConnectionHandler onClosed)
+    : loop(loop), onRequest(std::move(onRequest)), onWritable(std::move(onWritable)),
+      onClosed(std::move(onClosed)) {}
+
+HttpListener::~HttpListener() {
+    for (auto& entry : connections) ::close(entry.first);
+    if (listenFd >= 0) ::close(listenFd);
+}
+
+bool HttpListener::start(const HttpListenerConfig& listenerConfig) {
+    config = listenerConfig;
+    sockaddr_in local = {};
+    local.sin_family = AF_INET;
+    local.sin_port = htons(static_cast<uint16_t>(config.port));
+    if (inet_pton(AF_INET, config.bindAddress.c_str(), &local.sin_addr) != 1) {
+        cerr << "Invalid " << config.name << " address: " << config.bindAddress << endl;
+        return false;
+    }
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int on = 1;
+    if (listenFd < 0 || setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0 ||
+        bind(listenFd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0 ||
+        listen(listenFd, SOMAXCONN) < 0 ||
+        loop.watch(listenFd, EPOLLIN, [this](uint32_t) { acceptConnections(); }) == 0) {
+        cerr << config.name << " on " << config.bindAddress << ":" << config.port << " failed: "
+             << strerror(errno) << endl;
+        return false;
+    }
+    return true;
+}
+
+void HttpListener::acceptConnections() {
+    while (true) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+        if (connections.size() >= config.maxClients) {
+            ::close(fd);
+            continue;
+        }
+        int on = 1;
+        if (config.noDelay) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        if (config.sendBufferBytes > 0) {
+            setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &config.sendBufferBytes, sizeof(config.sendBufferBytes));
+        }
+        if (connections.empty()) {
+            chrono::milliseconds interval(SWEEP_INTERVAL_MS);
+            sweepTask = loop.schedulePeriodic(interval, [this] { expireConnections(); }, interval);
+        }
+        Connection& connection = connections[fd];
+        connection.deadline = chrono::steady_clock::now() + chrono::milliseconds(REQUEST_TIMEOUT_MS);
+        connection.watch = loop.watch(fd, INPUT_EVENTS, [this, fd](uint32_t events) { handleEvents(fd, events); });
+        if (connection.watch == 0) close(fd);
+    }
+}
+
+void HttpListener::handleEvents(int fd, uint32_t events) {
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) readInput(fd);
+    if ((events & EPOLLOUT) && onWritable && connections.count(fd)) onWritable(fd);
+}
+
+// Collects the request headers, then only watches for the peer going away;
+// anything else it sends is discarded
+void HttpListener::readInput(int fd) {
+    auto it = connections.find(fd);
+    if (it == connections.end()) return;
+    Connection& connection = it->second;
+
+    char buffer[1024];
+    bool peerDone = false;
+    while (true) {
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n > 0) {
+            if (!connection.answered && connection.request.size() <= MAX_REQUEST_SIZE) {
+                connection.request.append(buffer, n);
+            }
+            continue;
+        }
+        peerDone = n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+        break;
+    }
+    if (connection.answered) {
+        if (peerDone) close(fd);
+        return;
+    }
+    // An oversized request is handed over as is, to be rejected
+    bool complete = connection.request.find("\r\n\r\n") != string::npos ||
+                    connection.request.size() > MAX_REQUEST_SIZE;
+    if (complete) {
+        string request;
+        request.swap(connection.request);
+        connection.answered = true;
+        connection.deadline = chrono::steady_clock::time_point::max();
+        onRequest(fd, request);
+    } else if (peerDone) {
+        close(fd);
+    }
+}
+
+void HttpListener::close(int fd) {
+    auto it = connections.find(fd);
+    if (it == connections.end()) return;
+    bool answered = it->second.answered;
+    loop.unwatch(it->second.watch);
+    ::close(fd);
+    connections.erase(it);
+    if (connections.empty()) {
+        loop.cancel(sweepTask);
+        sweepTask = 0;
+    }
+    if (answered && onClosed) onClosed(fd);
+}
+
+void HttpListener::wantWrite(int fd, bool armed) {
+    auto it = connections.find(fd);
+    if (it == connections.end() || it->second.writeArmed == armed) return;
+    loop.modify(it->second.watch, armed ? INPUT_EVENTS | EPOLLOUT : INPUT_EVENTS);
+    it->second.writeArmed = armed;
+}
+
+void HttpListener::setDeadline(int fd, chrono::steady_clock::time_point deadline) {
+    auto it = connections.find(fd);
+    if (it != connections.end()) it->second.deadline = deadline;
+}
+
+void HttpListener::clearDeadline(int fd) {
+    setDeadline(fd, chrono::steady_clock::time_point::max());
+}
+
+void HttpListener::expireConnections() {
+    auto now = chrono::steady_clock::now();
+    for (auto it = connections.begin(); it != connections.end();) {
+        int fd = it->first;
+        bool expired = now >= it->second.deadline;
+        ++it; // close() erases
+        if (expired) close(fd);
+    }
+}
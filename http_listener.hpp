@@ -0,0 +1,74 @@
+#pragma once
+
+#include "event_loop.hpp"
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <string>
+
+struct HttpListenerConfig {
+    std::string name;        // For error messages, e.g. "HTTP stream"
+    std::string bindAddress;
+    int port = 0;
+    size_t maxClients = 16;  // Connections beyond this are closed on accept
+    int sendBufferBytes = 0; // 0 keeps the system default
+    bool noDelay = false;
+};
+
+// The non-blocking HTTP front end the app's endpoints share, on an EventLoop:
+// accepts up to a client cap, collects each request's headers within a
+// timeout and hands the request over once. The owner answers on the loop
+// thread and then either closes the connection or keeps it to stream on,
+// with write readiness and a progress deadline managed here.
+class HttpListener {
+public:
+    using RequestHandler = std::function<void(int fd, const std::string& request)>;
+    using ConnectionHandler = std::function<void(int fd)>;
+
+    // onWritable follows wantWrite(fd, true); onClosed is called for every
+    // connection whose request was handed over, however it ends
+    HttpListener(EventLoop& loop, RequestHandler onRequest, ConnectionHandler onWritable = nullptr,
+                 ConnectionHandler onClosed = nullptr);
+    // Closes every descriptor without calling back. The loop must have
+    // stopped first; it may already be gone.
+    ~HttpListener();
+
+    HttpListener(const HttpListener&) = delete;
+    HttpListener& operator=(const HttpListener&) = delete;
+
+    // Registers with the (started) loop. Returns false if the address could
+    // not be bound.
+    bool start(const HttpListenerConfig& config);
+
+    // Loop thread only
+    void close(int fd);
+    void wantWrite(int fd, bool armed);
+    // The connection is closed if it is still open at the deadline
+    void setDeadline(int fd, std::chrono::steady_clock::time_point deadline);
+    void clearDeadline(int fd);
+
+private:
+    struct Connection {
+        EventLoop::WatchId watch = 0;
+        bool answered = false; // Request handed over; later input is discarded
+        bool writeArmed = false;
+        std::string request;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    void acceptConnections();
+    void handleEvents(int fd, uint32_t events);
+    void readInput(int fd);
+    void expireConnections();
+
+    EventLoop& loop;
+    const RequestHandler onRequest;
+    const ConnectionHandler onWritable;
+    const ConnectionHandler onClosed;
+
+    HttpListenerConfig config;
+    int listenFd = -1;
+    std::map<int, Connection> connections;
+    EventLoop::TaskId sweepTask = 0; // Only scheduled while there are connections
+};
@@ -0,0 +1,134 @@
+#include "hud_layer.hpp"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+using namespace cv;
+
+// x / 255 rounded, exact for any product of two bytes; stays within 16 bits
+// so the blend loop vectorises in 16-bit lanes
+static inline uint16_t div255(uint16_t x) {
+    uint16_t t = x + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+// dst = dst * inverse / 255 + premultiplied over one row. Blocks of a fixed
+// 16 bytes let the compiler vectorise even at -O2.
+static void blendRow(uchar* __restrict dst, const uchar* __restrict premultiplied,
+                     const uchar* __restrict inverse, int bytes) {
+    const int BLOCK = 16;
+    int i = 0;
+    for (; i + BLOCK <= bytes; i += BLOCK) {
+        for (int k = 0; k < BLOCK; k++) {
+            dst[i + k] = static_cast<uchar>(div255(static_cast<uint16_t>(dst[i + k] * inverse[i + k]))
+                                            + premultiplied[i + k]);
+        }
+    }
+    for (; i < bytes; i++) {
+        dst[i] = static_cast<uchar>(div255(static_cast<uint16_t>(dst[i] * inverse[i])) + premultiplied[i]);
+    }
+}
+
+static void ensureCapacity(Mat& store, Size size, int type) {
+    if (store.rows >= size.height && store.cols >= size.width) return;
+    store.create(max(store.rows, size.height), max(store.cols, size.width), type);
+}
+
+HudLayer::Element& HudLayer::element(size_t id) {
+    if (id >= elements.size()) {
+        elements.resize(id + 1);
+        for (Element& e : elements) e.text.reserve(MAX_TEXT);
+    }
+    return elements[id];
+}
+
+void HudLayer::setText(size_t id, Point origin, const Font& font, const Scalar& color, const char* text) {
+    Element& e = element(id);
+    Vec3b bgr(saturate_cast<uchar>(color[0]), saturate_cast<uchar>(color[1]), saturate_cast<uchar>(color[2]));
+    e.origin = origin;
+    e.visible = true;
+    if (e.text.compare(text) != 0 || !(e.font == font) || e.size.area() == 0) {
+        e.text.assign(text, min(strlen(text), MAX_TEXT - 1));
+        e.font = font;
+        e.color = bgr;
+        rasterise(e);
+    } else if (e.color != bgr) {
+        e.color = bgr;
+        applyColor(e);
+    }
+}
+
+void HudLayer::format(size_t id, Point origin, const Font& font, const Scalar& color, const char* format, ...) {
+    char buffer[MAX_TEXT];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length <= 0) {
+        hide(id);
+        return;
+    }
+    setText(id, origin, font, color, buffer);
+}
+
+void HudLayer::hide(size_t id) {
+    if (id < elements.size()) elements[id].visible = false;
+}
+
+void HudLayer::rasterise(Element& e) {
+    rasters++;
+    int baseline = 0;
+    Size textSize = getTextSize(e.text, e.font.face, e.font.scale, e.font.thickness, &baseline);
+    int pad = e.font.thickness + 1; // Stroke width and anti-aliasing spill past the text box
+    e.size = Size(textSize.width + 2 * pad, textSize.height + baseline + 2 * pad);
+    e.anchor = Point(pad, pad + textSize.height);
+
+    ensureCapacity(e.coverage, e.size, CV_8UC1);
+    ensureCapacity(e.premultiplied, e.size, CV_8UC3);
+    ensureCapacity(e.inverse, e.size, CV_8UC3);
+    Mat coverage = e.coverage(Rect(Point(), e.size));
+    coverage.setTo(Scalar::all(0));
+    putText(coverage, e.text, e.anchor, e.font.face, e.font.scale, Scalar::all(255), e.font.thickness,
+            e.font.lineType);
+    applyColor(e);
+}
+
+void HudLayer::applyColor(Element& e) {
+    for (int y = 0; y < e.size.height; y++) {
+        const uchar* coverage = e.coverage.ptr<uchar>(y);
+        uchar* premultiplied = e.premultiplied.ptr<uchar>(y);
+        uchar* inverse = e.inverse.ptr<uchar>(y);
+        for (int x = 0; x < e.size.width; x++) {
+            uint16_t alpha = coverage[x];
+            for (int c = 0; c < 3; c++) {
+                premultiplied[3 * x + c] = static_cast<uchar>(div255(e.color[c] * alpha));
+                inverse[3 * x + c] = static_cast<uchar>(255 - alpha);
+            }
+        }
+    }
+}
+
+void HudLayer::compose(Mat& frame) const {
+    CV_Assert(frame.type() == CV_8UC3);
+    Rect bounds(0, 0, frame.cols, frame.rows);
+    for (const Element& e : elements) {
+        if (!e.visible) continue;
+        Rect placed(e.origin - e.anchor, e.size);
+        Rect visible = placed & bounds;
+        if (visible.empty()) continue;
+        Point offset = visible.tl() - placed.tl();
+
+        // dst * (1 - alpha) + color * alpha, with both terms precomputed per
+        // byte. Never exceeds 255, since premultiplied <= alpha.
+        int bytes = visible.width * 3;
+        for (int y = 0; y < visible.height; y++) {
+            uchar* dst = frame.ptr<uchar>(visible.y + y) + visible.x * 3;
+            const uchar* premultiplied = e.premultiplied.ptr<uchar>(offset.y + y) + offset.x * 3;
+            const uchar* inverse = e.inverse.ptr<uchar>(offset.y + y) + offset.x * 3;
+            blendRow(dst, premultiplied, inverse, bytes);
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Cached HUD text. Each element keeps its text rasterised as a coverage
+// bitmap, redrawn only when the text or font changes; moving or recoloring an
+// element costs no rasterisation. compose() then alpha-blends every visible
+// element onto the frame in one pass over their regions. Elements are
+// addressed by small caller-chosen ids. Render thread only.
+class HudLayer {
+public:
+    struct Font {
+        int face = cv::FONT_HERSHEY_SIMPLEX;
+        double scale = 0.4;
+        int thickness = 1;
+        int lineType = cv::LINE_8;
+
+        bool operator==(const Font& other) const {
+            return face == other.face && scale == other.scale && thickness == other.thickness
+                && lineType == other.lineType;
+        }
+    };
+
+    static const size_t MAX_TEXT = 96; // Longest element text, including the terminator
+
+    // Shows element `id` with its baseline starting at origin, as putText would
+    void setText(size_t id, cv::Point origin, const Font& font, const cv::Scalar& color, const char* text);
+    void format(size_t id, cv::Point origin, const Font& font, const cv::Scalar& color, const char* format, ...)
+        __attribute__((format(printf, 6, 7)));
+    void hide(size_t id);
+
+    // Blends the visible elements onto a BGR frame
+    void compose(cv::Mat& frame) const;
+
+    // Elements rasterised so far, for measuring the cache
+    uint64_t rasterCount() const { return rasters; }
+
+private:
+    struct Element {
+        std::string text;
+        Font font;
+        cv::Vec3b color;
+        cv::Point origin;
+        cv::Point anchor; // Where origin falls inside the bitmap
+        cv::Size size;
+        bool visible = false;
+        // Bitmaps grow to the largest text seen and are used through a view of
+        // the current size, so changing the text does not reallocate them
+        cv::Mat coverage;      // 8UC1, 255 = fully covered
+        cv::Mat premultiplied; // 8UC3, color * coverage / 255
+        cv::Mat inverse;       // 8UC3, 255 - coverage on every channel
+    };
+
+    Element& element(size_t id);
+    void rasterise(Element& element);
+    void applyColor(Element& element);
+
+    std::vector<Element> elements;
+    uint64_t rasters = 0;
+};
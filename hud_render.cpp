@@ -0,0 +1,139 @@
+#include "hud_render.hpp"
+#include "kernel_log.hpp"
+#include "stage_metrics.hpp"
+#include "tint.hpp"
+
+#include <cstdio>
+
+using namespace std;
+using namespace cv;
+
+// HUD text elements, each cached in the stream's HudLayer
+static const size_t MAX_TRACK_LABELS = 16; // Further tracks get a box but no label
+enum HudElement : size_t {
+    HUD_FPS,
+    HUD_CPU,
+    HUD_RAM,
+    HUD_STORAGE,
+    HUD_NET,
+    HUD_ANALYSIS,
+    HUD_DATE,
+    HUD_DETECT_QUEUE,
+    HUD_RENDER_QUEUE,
+    HUD_CONTROLLER,
+    HUD_PROCESS,
+    HUD_HOT_THREAD,
+    HUD_MOTION,
+    HUD_STAGE_LINES,
+    HUD_TRACK_LABELS = HUD_STAGE_LINES + static_cast<size_t>(Stage::Count),
+    HUD_KERNEL_LOG = HUD_TRACK_LABELS + MAX_TRACK_LABELS
+};
+static const HudLayer::Font HUD_FONT{FONT_HERSHEY_SIMPLEX, 0.4, 1, LINE_8};
+static const HudLayer::Font STAGE_FONT{FONT_HERSHEY_PLAIN, 0.8, 1, LINE_8};
+
+static void drawTracks(Mat& frame, HudLayer& hud, const vector<FaceTrack>* tracks, uint64_t seq,
+                       const Scalar& color) {
+    size_t labels = 0;
+    if (tracks) {
+        for (const auto& track : *tracks) {
+            Rect box = track.predict(seq);
+            rectangle(frame, box, color, 2);
+            if (labels < MAX_TRACK_LABELS) {
+                hud.format(HUD_TRACK_LABELS + labels++, Point(box.x, box.y - 4), HUD_FONT, color, "ID %d",
+                           track.id);
+            }
+        }
+    }
+    for (; labels < MAX_TRACK_LABELS; labels++) hud.hide(HUD_TRACK_LABELS + labels);
+}
+
+static void drawQueueStats(HudLayer& hud, size_t id, const char* label, const QueueStatus& q, int y) {
+    hud.format(id, Point(10, y), HUD_FONT, Scalar(255, 255, 255), "%s: %zu/%zu DROP: %llu", label, q.size,
+               q.capacity, static_cast<unsigned long long>(q.dropped));
+}
+
+void describeStageLatencies(vector<string>& lines) {
+    lines.resize(static_cast<size_t>(Stage::Count));
+    char buffer[HudLayer::MAX_TEXT];
+    for (int i = 0; i < static_cast<int>(Stage::Count); i++) {
+        Stage stage = static_cast<Stage>(i);
+        LatencyHistogram::Summary summary = stageHistogram(stage).summarize();
+        if (summary.count == 0) {
+            lines[i].clear();
+            continue;
+        }
+        snprintf(buffer, sizeof(buffer), "%-15s%.2f/%.2f/%.2fms", stageName(stage), summary.p50 * 1000,
+                 summary.p95 * 1000, summary.p99 * 1000);
+        lines[i] = buffer;
+    }
+}
+
+void drawHud(Mat& display, HudLayer& hud, const HudFrame& frame) {
+    CV_Assert(frame.stats);
+    const SystemStats& stats = *frame.stats;
+    bool analysisMode = frame.analysisMode;
+
+    // Boxes are drawn after tinting, so pre-tint their color
+    drawTracks(display, hud, frame.tracks, frame.seq, tintColor(Scalar(255, 255, 255), analysisMode));
+
+    // Draw kernel logs
+    {
+        ScopedStageTimer timer(Stage::KernelLog);
+        drawKernelLogs(hud, HUD_KERNEL_LOG, display.size(), analysisMode);
+    }
+
+    // Text is only rasterised when it changes; the layer is blended on at the end
+    ScopedStageTimer textTimer(Stage::HudText);
+    Scalar textColor = analysisMode ? Scalar(255, 255, 255) : Scalar(255, 255, 255);
+
+    hud.format(HUD_FPS, Point(10, 20), HUD_FONT, textColor, "FPS: %.1f", frame.fps);
+    hud.format(HUD_CPU, Point(10, 35), HUD_FONT, textColor, "CPU: %.2f%% PEAK: %.0f%%", stats.cpuUsage,
+               stats.busiestCore);
+    hud.format(HUD_RAM, Point(10, 50), HUD_FONT, textColor, "RAM: %.2f%%", stats.ramUsage);
+    hud.format(HUD_STORAGE, Point(10, 65), HUD_FONT, textColor, "STO: %.2f%%", stats.storageUsage);
+    hud.format(HUD_NET, Point(10, 80), HUD_FONT, textColor, "NET: %s", stats.netStatus.c_str());
+
+    if (analysisMode) {
+        Scalar statusColor = Scalar(30, 30, 255);
+        hud.setText(HUD_ANALYSIS, Point(display.cols - 150, 20), HUD_FONT, statusColor, "ANALYSIS ACTIVE");
+    } else {
+        hud.hide(HUD_ANALYSIS);
+    }
+
+    hud.setText(HUD_DATE, Point(display.cols - 160, 35), HUD_FONT, textColor, stats.dateTime.c_str());
+
+    // Per-stage queue depth and dropped frames
+    drawQueueStats(hud, HUD_DETECT_QUEUE, "DETQ", frame.detectQueue, 95);
+    drawQueueStats(hud, HUD_RENDER_QUEUE, "RENQ", frame.renderQueue, 110);
+
+    // Current detection settings
+    hud.setText(HUD_CONTROLLER, Point(10, 125), HUD_FONT, Scalar(255, 255, 255), frame.controller);
+
+    // What this process costs, and which of its threads is busiest
+    hud.format(HUD_PROCESS, Point(10, 140), HUD_FONT, Scalar(255, 255, 255), "PROC: %.0f%% %.0fMB",
+               stats.processCpu, stats.processRssMb);
+    hud.format(HUD_HOT_THREAD, Point(10, 155), HUD_FONT, Scalar(255, 255, 255), "HOT: %s %.0f%%",
+               stats.hotThread.empty() ? "-" : stats.hotThread.c_str(), stats.hotThreadCpu);
+
+    // How much of the scene moves, and what that saved
+    const MotionGate::Stats& motion = frame.motion;
+    hud.format(HUD_MOTION, Point(10, 170), HUD_FONT, Scalar(255, 255, 255),
+               "MOTION: %.0f%% SKIP %llu PART %llu FULL %llu", motion.changedFraction * 100,
+               static_cast<unsigned long long>(motion.skipped), static_cast<unsigned long long>(motion.partialScans),
+               static_cast<unsigned long long>(motion.fullScans));
+
+    // Stage latencies as p50/p95/p99
+    int stageY = 190;
+    size_t shown = 0;
+    if (frame.stageLines) {
+        for (const string& line : *frame.stageLines) {
+            if (line.empty()) continue;
+            hud.setText(HUD_STAGE_LINES + shown++, Point(10, stageY), STAGE_FONT, Scalar(255, 255, 255),
+                        line.c_str());
+            stageY += 13;
+        }
+    }
+    for (; shown < static_cast<size_t>(Stage::Count); shown++) hud.hide(HUD_STAGE_LINES + shown);
+
+    hud.compose(display);
+}
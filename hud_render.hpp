@@ -0,0 +1,54 @@
+#pragma once
+
+#include "hud_layer.hpp"
+#include "motion_gate.hpp"
+#include "multi_tracker.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// System-wide figures shown on every stream's HUD
+struct SystemStats {
+    float cpuUsage = 0.0f;
+    float ramUsage = 0.0f;
+    float storageUsage = 0.0f;
+    float busiestCore = 0.0f;
+    float processCpu = 0.0f;   // % of one core
+    float processRssMb = 0.0f;
+    std::string hotThread;     // Our busiest thread
+    float hotThreadCpu = 0.0f;
+    int batteryPercent = -1;
+    std::string netStatus = "Disconnected";
+    std::string dateTime = "";
+};
+
+struct QueueStatus {
+    size_t size = 0;
+    size_t capacity = 0;
+    uint64_t dropped = 0;
+};
+
+// Everything one frame's HUD shows, gathered by the render loop
+struct HudFrame {
+    bool analysisMode = false;
+    float fps = 0.0f;
+    const SystemStats* stats = nullptr;
+    QueueStatus detectQueue;
+    QueueStatus renderQueue;
+    const char* controller = "";                    // DetectionController::describe
+    MotionGate::Stats motion;
+    const std::vector<std::string>* stageLines = nullptr; // From describeStageLatencies, may be null
+    const std::vector<FaceTrack>* tracks = nullptr; // Null when the results are too stale to show
+    uint64_t seq = 0;                               // Frame the tracks are extrapolated to
+};
+
+// One line per stage, empty for stages that have not run yet. Refreshed by the
+// render loop about once a second; the lines keep their capacity between calls.
+void describeStageLatencies(std::vector<std::string>& lines);
+
+// Draws the track boxes, the log panel and the HUD text over an already tinted
+// display frame, through the stream's text layer
+void drawHud(cv::Mat& display, HudLayer& hud, const HudFrame& frame);
@@ -0,0 +1,166 @@
+#include "kernel_log.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+using namespace cv;
+
+// Power of two, comfortably more than the panel shows so a burst of logs
+// cannot overwrite a record the renderer is still reading
+static const size_t LOG_RING_SIZE = 64;
+static const size_t LOG_RECORD_WORDS = (sizeof(LogRecord) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+// Each slot is a small seqlock. seq is 2*(ticket+1) once the record for that
+// ticket is complete and odd while it is being written. The payload is stored
+// as relaxed atomic words so readers racing a writer are well defined; they
+// detect the race from seq and drop the copy.
+struct alignas(64) LogSlot {
+    atomic<uint64_t> seq{0};
+    atomic<uint64_t> words[LOG_RECORD_WORDS];
+};
+
+static LogSlot logRing[LOG_RING_SIZE];
+static atomic<uint64_t> nextTicket{0};
+static atomic<uint64_t> firstVisible{0}; // Tickets below this were cleared
+
+string getCurrentDateTime() {
+    auto now = chrono::system_clock::now();
+    time_t now_c = chrono::system_clock::to_time_t(now);
+    tm now_tm = *localtime(&now_c);
+    stringstream ss;
+    ss << put_time(&now_tm, "%Y-%m-%d %H:%M:%S");
+    return ss.str();
+}
+
+static void formatLogRecord(LogRecord& record, const string& message, int severity) {
+    auto now = chrono::system_clock::now();
+    time_t now_c = chrono::system_clock::to_time_t(now);
+    int millis = static_cast<int>(chrono::duration_cast<chrono::milliseconds>(
+        now.time_since_epoch()).count() % 1000);
+    tm now_tm;
+    localtime_r(&now_c, &now_tm);
+
+    memset(&record, 0, sizeof(record));
+    record.severity = severity;
+    snprintf(record.text, sizeof(record.text), "[%02d:%02d:%02d.%03d] %s",
+             now_tm.tm_hour, now_tm.tm_min, now_tm.tm_sec, millis, message.c_str());
+}
+
+void addKernelLog(const string& message, int severity) {
+    // Format before claiming a slot so the slot is held for as short as possible
+    uint64_t words[LOG_RECORD_WORDS] = {};
+    LogRecord record;
+    formatLogRecord(record, message, severity);
+    memcpy(words, &record, sizeof(record));
+
+    uint64_t ticket = nextTicket.fetch_add(1, memory_order_relaxed);
+    LogSlot& slot = logRing[ticket % LOG_RING_SIZE];
+    uint64_t complete = 2 * (ticket + 1);
+
+    // Claim the slot. Another producer only gets here first if it is a whole
+    // ring ahead (its record is newer, so ours is dropped) or behind (wait for
+    // it to finish, then overwrite)
+    uint64_t current = slot.seq.load(memory_order_relaxed);
+    while (true) {
+        if (current >= complete) return;
+        if (current & 1) {
+            this_thread::yield();
+            current = slot.seq.load(memory_order_relaxed);
+            continue;
+        }
+        if (slot.seq.compare_exchange_weak(current, complete - 1, memory_order_acquire, memory_order_relaxed)) {
+            break;
+        }
+    }
+
+    // Payload stores may not move above the odd marker
+    atomic_thread_fence(memory_order_release);
+    for (size_t i = 0; i < LOG_RECORD_WORDS; i++) {
+        slot.words[i].store(words[i], memory_order_relaxed);
+    }
+    slot.seq.store(complete, memory_order_release);
+}
+
+void clearKernelLogs() {
+    firstVisible.store(nextTicket.load(memory_order_relaxed), memory_order_relaxed);
+}
+
+int snapshotKernelLogs(LogRecord* out, int max) {
+    uint64_t end = nextTicket.load(memory_order_acquire);
+    uint64_t begin = firstVisible.load(memory_order_relaxed);
+    if (end - begin > LOG_RING_SIZE) begin = end - LOG_RING_SIZE;
+
+    // Walk back from the newest ticket, then reverse so the oldest comes first
+    int count = 0;
+    for (uint64_t ticket = end; ticket > begin && count < max; ticket--) {
+        const LogSlot& slot = logRing[(ticket - 1) % LOG_RING_SIZE];
+        uint64_t expected = 2 * ticket;
+
+        if (slot.seq.load(memory_order_acquire) != expected) continue; // In flight or overwritten
+        uint64_t words[LOG_RECORD_WORDS];
+        for (size_t i = 0; i < LOG_RECORD_WORDS; i++) {
+            words[i] = slot.words[i].load(memory_order_relaxed);
+        }
+        atomic_thread_fence(memory_order_acquire);
+        if (slot.seq.load(memory_order_relaxed) != expected) continue; // Overwritten while copying
+
+        memcpy(&out[count], words, sizeof(LogRecord));
+        out[count].text[LOG_TEXT_SIZE - 1] = '\0';
+        count++;
+    }
+    reverse(out, out + count);
+    return count;
+}
+
+void drawKernelLogs(HudLayer& hud, size_t firstElement, Size frameSize, bool analysisMode) {
+    static const HudLayer::Font HEADER_FONT{FONT_HERSHEY_PLAIN, 0.7, 1, LINE_AA};
+    static const HudLayer::Font LINE_FONT{FONT_HERSHEY_PLAIN, 0.6, 1, LINE_AA};
+    static LogRecord records[MAX_LOG_ENTRIES];
+    int count = snapshotKernelLogs(records, MAX_LOG_ENTRIES);
+
+    int logHeight = MAX_LOG_ENTRIES * 18 + 20;
+    int logWidth = 220; // Further reduced width
+    int startX = frameSize.width - logWidth + 5; // Push even more to the right
+    int startY = frameSize.height - logHeight - 10;
+
+    // Draw header based on state
+    Scalar headerColor = analysisMode ? Scalar(50, 50, 255) : Scalar(50, 230, 50);
+    hud.setText(firstElement, Point(startX + 2, startY + 15), HEADER_FONT, headerColor, "[ LOG ]");
+
+    // Draw logs with color coding that matches the active state
+    for (int i = 0; i < MAX_LOG_ENTRIES; i++) {
+        size_t id = firstElement + 1 + i;
+        if (i >= count) {
+            hud.hide(id);
+            continue;
+        }
+        const LogRecord& log = records[i];
+
+        Scalar color;
+        if (analysisMode) {
+            switch (log.severity) {
+                case 0: color = Scalar(100, 100, 200); break;
+                case 1: color = Scalar(50, 120, 220); break;
+                case 2: color = Scalar(30, 70, 255); break;
+                case 3: color = Scalar(30, 30, 255); break;
+            }
+        } else {
+            switch (log.severity) {
+                case 0: color = Scalar(50, 230, 50); break;
+                case 1: color = Scalar(80, 220, 200); break;
+                case 2: color = Scalar(50, 200, 255); break;
+                case 3: color = Scalar(50, 50, 255); break;
+            }
+        }
+
+        hud.setText(id, Point(startX + 2, startY + 40 + (i * 18)), LINE_FONT, color, log.text);
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "hud_layer.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <string>
+
+static const int MAX_LOG_ENTRIES = 8;
+static const size_t KERNEL_LOG_ELEMENTS = MAX_LOG_ENTRIES + 1; // HUD elements the log panel uses
+static const size_t LOG_TEXT_SIZE = 64; // Including the terminator; longer lines are truncated
+
+// One pre-formatted log line, e.g. "[12:34:56.789] Camera active"
+struct LogRecord {
+    int severity; // 0-3: info, notice, warning, error
+    char text[LOG_TEXT_SIZE];
+};
+
+std::string getCurrentDateTime();
+
+// Safe to call from any thread; never blocks, and overwrites the oldest entry
+// once the ring is full
+void addKernelLog(const std::string& message, int severity);
+void clearKernelLogs();
+
+// Copies the newest complete records, oldest first, into out[0..max) and
+// returns how many were copied. Never blocks; a record being written at that
+// moment is skipped.
+int snapshotKernelLogs(LogRecord* out, int max);
+
+// Lays out the log panel in the bottom-right corner of a frameSize frame,
+// colored for the active mode, as hud elements firstElement onwards. Lines that
+// have not changed keep their cached bitmaps. Only called from the render thread.
+void drawKernelLogs(HudLayer& hud, size_t firstElement, cv::Size frameSize, bool analysisMode);
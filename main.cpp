@@ -12,52 +12,45 @@
 #include <filesystem>
 #include <queue>
 #include <random>
-#include <sys/statvfs.h>
-#include <sys/resource.h>
+#include <atomic>
+#include <deque>
+#include <csignal>
+
+#include "alloc_hook.hpp"
+#include "camera_stream.hpp"
+#include "detection_scheduler.hpp"
+#include "event_loop.hpp"
+#include "face_detector.hpp"
+#include "face_tracker.hpp"
+#include "frame_pool.hpp"
+#include "frame_queue.hpp"
+#include "frame_source.hpp"
+#include "hud_layer.hpp"
+#include "hud_render.hpp"
+#include "kernel_log.hpp"
+#include "metrics_exporter.hpp"
+#include "metrics_sampler.hpp"
+#include "mjpeg_server.hpp"
+#include "multi_tracker.hpp"
+#include "net_probe.hpp"
+#include "offline.hpp"
+#include "snapshot_writer.hpp"
+#include "stage_metrics.hpp"
+#include "thread_name.hpp"
+#include "tint.hpp"
 
 using namespace std;
 using namespace cv;
 namespace fs = std::filesystem;
 
 // Shared variables with mutex protection
-struct SystemStats {
-    float cpuUsage = 0.0f;
-    float ramUsage = 0.0f;
-    float storageUsage = 0.0f;
-    float fps = 0.0f;
-    string netStatus = "Disconnected";
-    string batteryStatus = "Unknown";
-    string dateTime = "";
-};
-
-// Kernel log structure
-struct KernelLog {
-    string timestamp;
-    string message;
-    int severity; // 0-3: info, notice, warning, error
-};
-
 static mutex statsMutex;
-static mutex logMutex;
-static long double prevTotal = 0, prevIdle = 0;
-static bool running = true;
-static queue<KernelLog> kernelLogs;
-static const int MAX_LOG_ENTRIES = 8;
-
-// Face detection tracking
-static bool faceDetected = false;
-static Rect lastFaceRect;
-static const int FACE_POSITION_THRESHOLD = 100;
-static chrono::steady_clock::time_point lastCaptureTimePoint;
-static chrono::steady_clock::time_point faceDetectionStartTime;
-static const int COOLDOWN_SECONDS = 5;
-static const int DETECTION_WINDOW_SECONDS = 1;
-static bool isInCooldown = false;
-static int noFaceCounter = 0;
-static const int NO_FACE_THRESHOLD = 10;
-static bool pictureTaken = false;
-static chrono::steady_clock::time_point lastFaceSeenTime;
-static bool isNewPerson = true;
+static atomic<bool> running{true};
+
+// Lock-free atomic store, so safe in a signal handler
+static void requestShutdown(int) {
+    running = false;
+}
 
 // Kernel log messages
 const vector<string> INFO_MESSAGES = {
@@ -111,458 +104,656 @@ const vector<string> TARGET_ACQUIRED_MESSAGES = {
     "Protocols engaged"
 };
 
-// Add these constants at the top with other constants
+// Pipeline queue defaults, overridable from the command line
+static const size_t DEFAULT_QUEUE_DEPTH = 2;
+static const int TARGET_FRAME_TIME_US = 41666; // 24 FPS
+static const int MIN_METRICS_INTERVAL_MS = 100;
+static const char* const DEFAULT_NET_TARGET = "8.8.8.8:53"; // Public DNS over TCP; numeric, so no lookup
+static const int NET_PROBE_TIMEOUT_MS = 2000;
 static const size_t MAX_MEMORY_USAGE = 300 * 1024 * 1024; // 300MB in bytes
-static const int MAX_QUEUE_SIZE = 100; // Limit log queue size
+static const uint64_t MAX_TRACK_EXTRAPOLATION = 30; // Frames to coast boxes without a fresh result
+static const int ALLOCATION_REPORT_SECONDS = 10; // Allocation hook builds: report period, first one is warmup
+
+struct PipelineConfig {
+    size_t queueDepth = DEFAULT_QUEUE_DEPTH;
+    QueuePolicy queuePolicy = QueuePolicy::DropOldest;
+    DetectionControllerConfig detection;
+    int fullSweepInterval = 5; // Detection passes per full-frame scan
+    int detectWorkers = 0;     // Shared detection workers, 0 = one per stream up to the core count
+    int detectThreads = 0;     // Pyramid threads per worker, 0 = share out the cores
+    vector<string> sources;    // Camera indices, video files or image directories
+    int metricsIntervalMs = 1000;
+    vector<string> netTargets; // Probe targets, DEFAULT_NET_TARGET when empty
+    int netIntervalMs = 5000;
+    SnapshotWriterConfig snapshots;
+    bool snapshotPolicySet = false;
+    SnapshotDedupConfig dedup;
+    ClipConfig clips;
+    MotionGateConfig motion;
+    int metricsPort = 0;       // Prometheus endpoint on 127.0.0.1, 0 = off
+    string metricsFile;        // Rewritten with the same text, empty = off
+    int metricsFileIntervalMs = 5000;
+    bool stageHud = false;     // Per-stage latencies on the HUD
+    bool nativeCapture = true; // Read cameras through V4L2 mmap when they offer YUYV/NV12
+    bool showWindow = true;    // imshow the HUD; off for hosts without a display
+    MjpegServerConfig http;    // HUD frames as MJPEG over HTTP, port 0 = off
+    DetectorConfig detector;
+};
 
-double calculateRectDistance(const Rect& rect1, const Rect& rect2) {
-    Point center1(rect1.x + rect1.width/2, rect1.y + rect1.height/2);
-    Point center2(rect2.x + rect2.width/2, rect2.y + rect2.height/2);
-    return sqrt(pow(center1.x - center2.x, 2) + pow(center1.y - center2.y, 2));
+void generateRandomLog(const vector<unique_ptr<CameraStream>>& streams) {
+    int logType = rand() % 20;
+    bool pictureTaken = any_of(streams.begin(), streams.end(),
+                               [](const auto& stream) { return stream->tracker.isPictureTaken(); });
+    bool faceDetected = any_of(streams.begin(), streams.end(),
+                               [](const auto& stream) { return stream->tracker.isFaceDetected(); });
+
+    // If picture was taken, prioritize target acquired messages
+    if (pictureTaken && (logType < 12)) {
+        addKernelLog(TARGET_ACQUIRED_MESSAGES[rand() % TARGET_ACQUIRED_MESSAGES.size()], 3); // Use severity 3 for red color
+    } else if (logType < 10) {
+        // Info logs are most common
+        addKernelLog(INFO_MESSAGES[rand() % INFO_MESSAGES.size()], 0);
+    } else if (logType < 17) {
+        // Security logs are next most common when face is detected
+        if (faceDetected) {
+            addKernelLog(SECURITY_MESSAGES[rand() % SECURITY_MESSAGES.size()], 1);
+        } else {
+            addKernelLog(INFO_MESSAGES[rand() % INFO_MESSAGES.size()], 0);
+        }
+    } else if (logType < 19) {
+        // Warnings are less common
+        addKernelLog(WARNING_MESSAGES[rand() % WARNING_MESSAGES.size()], 2);
+    } else {
+        // Errors are rare
+        addKernelLog(ERROR_MESSAGES[rand() % ERROR_MESSAGES.size()], 3);
+    }
 }
 
-string getCurrentDateTime() {
-    auto now = chrono::system_clock::now();
-    time_t now_c = chrono::system_clock::to_time_t(now);
-    tm now_tm = *localtime(&now_c);
-    stringstream ss;
-    ss << put_time(&now_tm, "%Y-%m-%d %H:%M:%S");
-    return ss.str();
+// Random logs every 0.8-2.3 s, each one scheduling the next
+void scheduleRandomLogs(EventLoop& events, const vector<unique_ptr<CameraStream>>& streams) {
+    events.scheduleOnce(chrono::milliseconds(800 + (rand() % 1500)), [&events, &streams] {
+        generateRandomLog(streams);
+        scheduleRandomLogs(events, streams);
+    });
 }
 
-string getKernelLogTimestamp() {
-    auto now = chrono::system_clock::now();
-    time_t now_c = chrono::system_clock::to_time_t(now);
-    tm now_tm = *localtime(&now_c);
-    stringstream ss;
-    ss << put_time(&now_tm, "%H:%M:%S.") << setw(3) << setfill('0') << rand() % 1000;
-    return ss.str();
-}
+// Refreshes the HUD's system figures; sample() runs on the event loop every intervalMs
+class SystemMonitor {
+public:
+    SystemMonitor(SystemStats& stats, int intervalMs) : stats(stats), intervalMs(intervalMs) {}
 
-void addKernelLog(const string& message, int severity) {
-    lock_guard<mutex> lock(logMutex);
-    
-    // Check current memory usage
-    struct rusage usage;
-    if (getrusage(RUSAGE_SELF, &usage) == 0) {
-        size_t currentMemory = usage.ru_maxrss * 1024; // Convert from KB to bytes
-        if (currentMemory > MAX_MEMORY_USAGE) {
-            // Clear some old logs if memory usage is too high
-            while (!kernelLogs.empty() && currentMemory > MAX_MEMORY_USAGE) {
-                kernelLogs.pop();
-                if (getrusage(RUSAGE_SELF, &usage) == 0) {
-                    currentMemory = usage.ru_maxrss * 1024;
-                }
-            }
-        }
+    void sample();
+
+private:
+    SystemStats& stats;
+    const int intervalMs;
+    MetricsSampler sampler;
+    MetricsSnapshot metrics;
+    bool memoryWarned = false;
+    int samplesSinceClock = 0;
+};
+
+void SystemMonitor::sample() {
+    sampler.sample(metrics);
+
+    // The sampler measures what this process and its threads cost
+    const ThreadUsage* hottest = metrics.threads.empty() ? nullptr : &metrics.threads[0];
+    float busiestCore = metrics.coreUsage.empty()
+                            ? 0.0f : *max_element(metrics.coreUsage.begin(), metrics.coreUsage.end());
+
+    // Formatting the clock allocates, so only do it about once a second
+    bool updateClock = samplesSinceClock == 0;
+    string dateTime = updateClock ? getCurrentDateTime() : string();
+    samplesSinceClock = (samplesSinceClock + 1) % max(1, 1000 / intervalMs);
+
+    {
+        lock_guard<mutex> lock(statsMutex);
+        stats.cpuUsage = metrics.cpuUsage;
+        stats.busiestCore = busiestCore;
+        stats.ramUsage = metrics.ramUsage;
+        stats.storageUsage = metrics.storageUsage;
+        stats.batteryPercent = metrics.batteryPercent;
+        stats.processCpu = metrics.processCpu;
+        stats.processRssMb = metrics.processRssBytes / (1024.0f * 1024.0f);
+        stats.hotThread = hottest ? hottest->name : "";
+        stats.hotThreadCpu = hottest ? hottest->cpu : 0.0f;
+        if (updateClock) stats.dateTime = std::move(dateTime);
     }
 
-    // Add new log with size limit
-    if (kernelLogs.size() < MAX_QUEUE_SIZE) {
-        kernelLogs.push({getKernelLogTimestamp(), message, severity});
+    // The log ring has a fixed size, so the memory cap is only watched here
+    // rather than on every log call
+    if (!memoryWarned && metrics.processRssBytes > MAX_MEMORY_USAGE) {
+        addKernelLog("Memory limit exceeded", 2);
+        memoryWarned = true;
     }
 }
 
-void generateRandomLogs() {
-    while (running) {
-        // Generate random logs periodically
-        this_thread::sleep_for(chrono::milliseconds(800 + (rand() % 1500)));
+// Runs on the event loop thread after every probe round
+void updateNetStatus(SystemStats& stats, const NetStatus& status) {
+    stringstream ss;
+    if (!status.linkUp) {
+        ss << "Link down";
+    } else if (status.connected) {
+        ss << "Connected " << fixed << setprecision(1) << status.rttMs << "ms";
+    } else {
+        ss << "Disconnected";
+    }
+    lock_guard<mutex> lock(statsMutex);
+    stats.netStatus = ss.str();
+}
 
-        int logType = rand() % 20;
+// Render-thread heap allocations, tallied when the allocation hook is built in
+struct AllocationCheck {
+    uint64_t allocations = 0;
+    uint64_t frames = 0;
+    int reports = 0;
+    chrono::steady_clock::time_point windowStart = chrono::steady_clock::now();
+};
 
-        // If picture was taken, prioritize target acquired messages
-        if (pictureTaken && (logType < 12)) {
-            addKernelLog(TARGET_ACQUIRED_MESSAGES[rand() % TARGET_ACQUIRED_MESSAGES.size()], 3); // Use severity 3 for red color
-        } else if (logType < 10) {
-            // Info logs are most common
-            addKernelLog(INFO_MESSAGES[rand() % INFO_MESSAGES.size()], 0);
-        } else if (logType < 17) {
-            // Security logs are next most common when face is detected
-            if (faceDetected) {
-                addKernelLog(SECURITY_MESSAGES[rand() % SECURITY_MESSAGES.size()], 1);
-            } else {
-                addKernelLog(INFO_MESSAGES[rand() % INFO_MESSAGES.size()], 0);
-            }
-        } else if (logType < 19) {
-            // Warnings are less common
-            addKernelLog(WARNING_MESSAGES[rand() % WARNING_MESSAGES.size()], 2);
-        } else {
-            // Errors are rare
-            addKernelLog(ERROR_MESSAGES[rand() % ERROR_MESSAGES.size()], 3);
-        }
+// Reports allocations per rendered frame once per window, skipping the first
+// (warmup) one: the steady state should not allocate
+static void reportAllocations(AllocationCheck& check, chrono::steady_clock::time_point now) {
+    if (now - check.windowStart < chrono::seconds(ALLOCATION_REPORT_SECONDS)) return;
+    if (check.reports++ > 0 && check.frames > 0) {
+        FramePool::Stats pool = framePool().stats();
+        cerr << "alloc hook: " << fixed << setprecision(2)
+             << static_cast<double>(check.allocations) / check.frames << " render allocations/frame over "
+             << check.frames << " frames; frame pool " << pool.buffers << " buffers ("
+             << pool.bytes / (1024 * 1024) << " MB), " << pool.reuses << " reuses, " << pool.fallbacks
+             << " fallbacks" << endl;
     }
+    check.allocations = 0;
+    check.frames = 0;
+    check.windowStart = now;
 }
 
-void systemMonitor(SystemStats& stats) {
-    while (running) {
-        ifstream statFile("/proc/stat");
-        if (statFile.is_open()) {
-            string line;
-            getline(statFile, line);
-            statFile.close();
-            istringstream ss(line);
-            string cpu;
-            long double user, nice, system, idle, iowait, irq, softirq, steal;
-            ss >> cpu >> user >> nice >> system >> idle >> iowait >> irq >> softirq >> steal;
-            long double totalCpu = user + nice + system + idle + iowait + irq + softirq + steal;
-            long double totalIdle = idle;
-            float cpuUsage = (prevTotal == 0) ? 0 : 100.0 * (1 - (totalIdle - prevIdle) / (totalCpu - prevTotal));
-            prevTotal = totalCpu;
-            prevIdle = totalIdle;
-
-            ifstream meminfo("/proc/meminfo");
-            long long total = 0, free = 0, available = 0;
-            while (getline(meminfo, line)) {
-                if (line.find("MemTotal:") == 0) sscanf(line.c_str(), "MemTotal: %lld kB", &total);
-                else if (line.find("MemFree:") == 0) sscanf(line.c_str(), "MemFree: %lld kB", &free);
-                else if (line.find("MemAvailable:") == 0) sscanf(line.c_str(), "MemAvailable: %lld kB", &available);
-            }
-            meminfo.close();
-            float ramUsage = (available > 0) ?
-            ((total - available) / static_cast<float>(total)) * 100.0 :
-            ((total - free) / static_cast<float>(total)) * 100.0;
-
-            string batteryStatus;
-            ifstream batteryFile("/sys/class/power_supply/BAT0/capacity");
-            if (batteryFile.is_open()) {
-                int capacity;
-                batteryFile >> capacity;
-                batteryStatus = "Battery: " + to_string(capacity) + "%";
-                batteryFile.close();
-            } else {
-                batteryStatus = "Battery: Unknown";
-            }
+// Tints one stream's frame into its display buffer and draws the HUD over it
+void renderStream(CameraStream& stream, const FramePacket& packet, const SystemStats& stats,
+                  const vector<string>& stageLines) {
+    Mat& display = stream.display;
+
+    // Calculate FPS every second
+    stream.frameCount++;
+    auto currentTime = chrono::steady_clock::now();
+    auto fpsElapsed = chrono::duration_cast<chrono::milliseconds>(currentTime - stream.lastFpsTime).count();
+    if (fpsElapsed >= 1000) {  // Update FPS every second
+        stream.fps = (stream.frameCount * 1000.0f) / fpsElapsed;
+        stream.frameCount = 0;
+        stream.lastFpsTime = currentTime;
+    }
 
-            // Get storage usage
-            struct statvfs stat;
-            if (statvfs("/", &stat) == 0) {
-                float total = stat.f_blocks * stat.f_frsize;
-                float available = stat.f_bfree * stat.f_frsize;
-                float used = total - available;
-                float storageUsage = (used / total) * 100.0;
-                
-                lock_guard<mutex> lock(statsMutex);
-                stats.cpuUsage = cpuUsage;
-                stats.ramUsage = ramUsage;
-                stats.storageUsage = storageUsage;
-                stats.batteryStatus = batteryStatus;
-                stats.dateTime = getCurrentDateTime();
-            }
-        }
-        this_thread::sleep_for(chrono::seconds(1));
+    // Read the mode once so the whole frame is drawn in one palette
+    bool analysisMode = stream.tracker.isPictureTaken();
+
+    // The packet frame is shared with the detection stage, so tint into our
+    // own buffer; the tint pass is also the copy
+    {
+        ScopedStageTimer timer(Stage::Tint);
+        applyTint(packet.frame, display, analysisMode);
     }
-}
 
-void pingNetwork(SystemStats& stats) {
-    while (running) {
-        const char* cmd = "ping -c 1 google.com > /dev/null 2>&1";
-        int result = system(cmd);
-        {
-            lock_guard<mutex> lock(statsMutex);
-            stats.netStatus = (result == 0) ? "Connected" : "Disconnected";
-        }
-        this_thread::sleep_for(chrono::seconds(5));
+    // Results take effect on the frame they were computed on (or the next one
+    // if it was dropped). In between, boxes are extrapolated from the tracks'
+    // velocities so they move smoothly on every frame.
+    DetectionResult result;
+    while (stream.resultQueue.tryPop(result)) {
+        stream.pendingResults.push_back(std::move(result));
+    }
+    size_t applied = 0;
+    while (applied < stream.pendingResults.size() && stream.pendingResults[applied].seq <= packet.seq) {
+        stream.latestResult = std::move(stream.pendingResults[applied++]);
     }
+    stream.pendingResults.erase(stream.pendingResults.begin(), stream.pendingResults.begin() + applied);
+
+    char controllerText[HudLayer::MAX_TEXT];
+    stream.controller.describe(controllerText, sizeof(controllerText));
+    HudFrame hud;
+    hud.analysisMode = analysisMode;
+    hud.fps = stream.fps;
+    hud.stats = &stats;
+    hud.detectQueue = {stream.detectQueue.size(), stream.detectQueue.capacity(), stream.detectQueue.droppedCount()};
+    hud.renderQueue = {stream.renderQueue.size(), stream.renderQueue.capacity(), stream.renderQueue.droppedCount()};
+    hud.controller = controllerText;
+    hud.motion = stream.motion.stats();
+    hud.stageLines = &stageLines;
+    if (packet.seq - stream.latestResult.seq <= MAX_TRACK_EXTRAPOLATION) hud.tracks = &stream.latestResult.tracks;
+    hud.seq = packet.seq;
+    drawHud(display, stream.hud, hud);
+}
+
+void printUsage(const char* prog) {
+    cerr << "Usage: " << prog << " [--queue-depth N] [--queue-policy drop|block]" << endl
+         << "         [--no-adapt] [--latency-budget MS] [SNAPSHOT OPTIONS] [SOURCE...]" << endl
+         << "       " << prog << " --offline [--jobs N] [SNAPSHOT OPTIONS] INPUT..." << endl
+         << "  SOURCE is a camera index (default 0), a video file, a raw .yuyv/.nv12 file or a directory of images" << endl
+         << "  INPUT is a video file, a raw .yuyv/.nv12 file or a directory of images" << endl
+         << "  --opencv-capture  Read cameras through OpenCV instead of native V4L2 buffers" << endl
+         << "  --detector haar|lbp|dnn  Detection backend (default haar)" << endl
+         << "  --model PATH  --model-config PATH  Cascade XML or network files (default: the backend's own)" << endl
+         << "  --confidence 0-1  Minimum network score for the dnn backend (default 0.5)" << endl
+         << "  --metrics-interval MS  System metrics sampling interval, at least 100 (default 1000)" << endl
+         << "  --net-target HOST:PORT|icmp:HOST  Connectivity probe target, repeatable (default "
+         << DEFAULT_NET_TARGET << ")" << endl
+         << "  --net-interval MS  Time between connectivity probes (default 5000)" << endl
+         << "  --detect-workers N  Detection workers shared by all sources (default: one per source)" << endl
+         << "  --full-sweep N  Scan the whole frame every Nth detection pass (default 5)" << endl
+         << "  --no-motion-gate  Scan for new faces even when nothing in view moves" << endl
+         << "  --motion-threshold LEVELS  Mean gray-level change that counts as motion (default 6)" << endl
+         << "  --full-scan-interval S  Longest time between full scans on a static scene (default 2)" << endl
+         << "  --detect-threads N  Threads per detector for the image pyramid (default: all cores)" << endl
+         << "  --metrics-port PORT  Serve per-stage latencies as Prometheus text on 127.0.0.1:PORT/metrics" << endl
+         << "  --metrics-file PATH  Rewrite PATH with the same text (default every 5000 ms)" << endl
+         << "  --metrics-file-interval MS  --stage-hud  Show per-stage p50/p95/p99 on the HUD" << endl
+         << "  --min-face PX  --max-face PX  Face sizes to search for (default 30, no limit)" << endl
+         << "  --no-window  Do not open HUD windows; stop with Ctrl+C" << endl
+         << "  --http-port PORT  Serve each source's HUD as MJPEG on http://HOST:PORT/stream/N" << endl
+         << "  --http-bind ADDR  Address to serve on (default 0.0.0.0)  --http-quality 0-100  (default 70)" << endl
+         << "Snapshot options:" << endl
+         << "  --snapshot-format jpg|png|webp  --jpeg-quality 0-100" << endl
+         << "  --snapshot-threads N  --snapshot-queue N" << endl
+         << "  --snapshot-policy drop-newest|drop-oldest|block" << endl
+         << "  --dedup-distance BITS  Skip captures whose face hashes within BITS of a recent one (default 10)" << endl
+         << "  --dedup-window S  How long a capture suppresses near-duplicates (default 600)  --no-dedup" << endl
+         << "Clip options (live sources):" << endl
+         << "  --clips  Save an MJPEG .avi around each capture, next to the snapshots" << endl
+         << "  --clip-memory MB  Compressed pre-roll kept per source (default 32)" << endl
+         << "  --clip-buffer MB  Clips being recorded or written, per source (default 64)" << endl
+         << "  --clip-pre S  --clip-post S  Seconds before and after the capture (default 10, 5)" << endl
+         << "  --clip-quality 0-100  JPEG quality of clip frames (default 75)" << endl;
 }
 
-void applyTint(Mat& frame) {
-    frame.forEach<Vec3b>([](Vec3b& pixel, const int* position) -> void {
-        if (pictureTaken) {
-            pixel[0] = static_cast<uchar>(min(pixel[0] * 1.5, 255.0));
-            pixel[1] = static_cast<uchar>(pixel[1] * 0.5);
-            pixel[2] = static_cast<uchar>(pixel[2] * 0.5);
+bool parseArgs(int argc, char** argv, PipelineConfig& config, bool& offline, OfflineConfig& offlineConfig) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--offline") {
+            offline = true;
+        } else if (arg == "--jobs" && i + 1 < argc) {
+            offlineConfig.jobs = atoi(argv[++i]);
+            if (offlineConfig.jobs <= 0) return false;
+        } else if (arg.rfind("--", 0) != 0) {
+            config.sources.push_back(arg);
+        } else if (arg == "--queue-depth" && i + 1 < argc) {
+            int depth = atoi(argv[++i]);
+            if (depth <= 0) return false;
+            config.queueDepth = depth;
+        } else if (arg == "--queue-policy" && i + 1 < argc) {
+            string policy = argv[++i];
+            if (policy == "drop") config.queuePolicy = QueuePolicy::DropOldest;
+            else if (policy == "block") config.queuePolicy = QueuePolicy::Block;
+            else return false;
+        } else if (arg == "--no-adapt") {
+            config.detection.enabled = false;
+        } else if (arg == "--latency-budget" && i + 1 < argc) {
+            config.detection.latencyBudgetMs = atof(argv[++i]);
+            if (config.detection.latencyBudgetMs <= 0) return false;
+        } else if (arg == "--metrics-interval" && i + 1 < argc) {
+            config.metricsIntervalMs = atoi(argv[++i]);
+            if (config.metricsIntervalMs < MIN_METRICS_INTERVAL_MS) return false;
+        } else if (arg == "--net-target" && i + 1 < argc) {
+            config.netTargets.push_back(argv[++i]);
+        } else if (arg == "--net-interval" && i + 1 < argc) {
+            config.netIntervalMs = atoi(argv[++i]);
+            if (config.netIntervalMs <= 0) return false;
+        } else if (arg == "--metrics-port" && i + 1 < argc) {
+            config.metricsPort = atoi(argv[++i]);
+            if (config.metricsPort <= 0 || config.metricsPort > 65535) return false;
+        } else if (arg == "--metrics-file" && i + 1 < argc) {
+            config.metricsFile = argv[++i];
+        } else if (arg == "--metrics-file-interval" && i + 1 < argc) {
+            config.metricsFileIntervalMs = atoi(argv[++i]);
+            if (config.metricsFileIntervalMs < MIN_METRICS_INTERVAL_MS) return false;
+        } else if (arg == "--stage-hud") {
+            config.stageHud = true;
+        } else if (arg == "--no-window") {
+            config.showWindow = false;
+        } else if (arg == "--http-port" && i + 1 < argc) {
+            config.http.port = atoi(argv[++i]);
+            if (config.http.port <= 0 || config.http.port > 65535) return false;
+        } else if (arg == "--http-bind" && i + 1 < argc) {
+            config.http.bindAddress = argv[++i];
+        } else if (arg == "--http-quality" && i + 1 < argc) {
+            config.http.jpegQuality = atoi(argv[++i]);
+            if (config.http.jpegQuality < 0 || config.http.jpegQuality > 100) return false;
+        } else if (arg == "--detector" && i + 1 < argc) {
+            if (!parseDetectorBackend(argv[++i], config.detector.backend)) return false;
+        } else if (arg == "--model" && i + 1 < argc) {
+            config.detector.modelPath = argv[++i];
+        } else if (arg == "--model-config" && i + 1 < argc) {
+            config.detector.configPath = argv[++i];
+        } else if (arg == "--confidence" && i + 1 < argc) {
+            config.detector.confidence = atof(argv[++i]);
+            if (config.detector.confidence <= 0 || config.detector.confidence >= 1) return false;
+        } else if (arg == "--opencv-capture") {
+            config.nativeCapture = false;
+        } else if (arg == "--detect-workers" && i + 1 < argc) {
+            config.detectWorkers = atoi(argv[++i]);
+            if (config.detectWorkers <= 0) return false;
+        } else if (arg == "--detect-threads" && i + 1 < argc) {
+            config.detectThreads = atoi(argv[++i]);
+            if (config.detectThreads <= 0) return false;
+        } else if (arg == "--min-face" && i + 1 < argc) {
+            int size = atoi(argv[++i]);
+            if (size <= 0) return false;
+            config.detection.fixed.minSize = Size(size, size);
+        } else if (arg == "--max-face" && i + 1 < argc) {
+            int size = atoi(argv[++i]);
+            if (size <= 0) return false;
+            config.detection.fixed.maxSize = Size(size, size);
+        } else if (arg == "--full-sweep" && i + 1 < argc) {
+            config.fullSweepInterval = atoi(argv[++i]);
+            if (config.fullSweepInterval <= 0) return false;
+        } else if (arg == "--no-motion-gate") {
+            config.motion.enabled = false;
+        } else if (arg == "--motion-threshold" && i + 1 < argc) {
+            config.motion.threshold = atof(argv[++i]);
+            if (config.motion.threshold <= 0) return false;
+        } else if (arg == "--full-scan-interval" && i + 1 < argc) {
+            config.motion.fullScanSeconds = atof(argv[++i]);
+            if (config.motion.fullScanSeconds <= 0) return false;
+        } else if (arg == "--dedup-distance" && i + 1 < argc) {
+            config.dedup.maxDistance = atoi(argv[++i]);
+            if (config.dedup.maxDistance < 0 || config.dedup.maxDistance > 64) return false;
+        } else if (arg == "--dedup-window" && i + 1 < argc) {
+            config.dedup.windowSeconds = atoi(argv[++i]);
+            if (config.dedup.windowSeconds <= 0) return false;
+        } else if (arg == "--no-dedup") {
+            config.dedup.maxDistance = -1;
+        } else if (arg == "--clips") {
+            config.clips.enabled = true;
+        } else if (arg == "--clip-memory" && i + 1 < argc) {
+            int mb = atoi(argv[++i]);
+            if (mb <= 0) return false;
+            config.clips.ringBytes = static_cast<size_t>(mb) * 1024 * 1024;
+        } else if (arg == "--clip-buffer" && i + 1 < argc) {
+            int mb = atoi(argv[++i]);
+            if (mb <= 0) return false;
+            config.clips.clipBytes = static_cast<size_t>(mb) * 1024 * 1024;
+        } else if (arg == "--clip-pre" && i + 1 < argc) {
+            config.clips.preRollSeconds = atof(argv[++i]);
+            if (config.clips.preRollSeconds < 0) return false;
+        } else if (arg == "--clip-post" && i + 1 < argc) {
+            config.clips.postRollSeconds = atof(argv[++i]);
+            if (config.clips.postRollSeconds < 0) return false;
+        } else if (arg == "--clip-quality" && i + 1 < argc) {
+            config.clips.jpegQuality = atoi(argv[++i]);
+            if (config.clips.jpegQuality < 0 || config.clips.jpegQuality > 100) return false;
+        } else if (arg == "--snapshot-format" && i + 1 < argc) {
+            string format = argv[++i];
+            if (format == "jpg" || format == "jpeg") config.snapshots.format = SnapshotFormat::Jpeg;
+            else if (format == "png") config.snapshots.format = SnapshotFormat::Png;
+            else if (format == "webp") config.snapshots.format = SnapshotFormat::Webp;
+            else return false;
+        } else if (arg == "--jpeg-quality" && i + 1 < argc) {
+            config.snapshots.jpegQuality = atoi(argv[++i]);
+            if (config.snapshots.jpegQuality < 0 || config.snapshots.jpegQuality > 100) return false;
+        } else if (arg == "--snapshot-threads" && i + 1 < argc) {
+            config.snapshots.threads = atoi(argv[++i]);
+            if (config.snapshots.threads <= 0) return false;
+        } else if (arg == "--snapshot-queue" && i + 1 < argc) {
+            int depth = atoi(argv[++i]);
+            if (depth <= 0) return false;
+            config.snapshots.queueDepth = depth;
+        } else if (arg == "--snapshot-policy" && i + 1 < argc) {
+            string policy = argv[++i];
+            if (policy == "drop-newest") config.snapshots.dropPolicy = SnapshotDropPolicy::DropNewest;
+            else if (policy == "drop-oldest") config.snapshots.dropPolicy = SnapshotDropPolicy::DropOldest;
+            else if (policy == "block") config.snapshots.dropPolicy = SnapshotDropPolicy::Block;
+            else return false;
+            config.snapshotPolicySet = true;
         } else {
-            pixel[0] = static_cast<uchar>(pixel[0] * 0.5);
-            pixel[1] = static_cast<uchar>(pixel[1] * 0.5);
-            pixel[2] = static_cast<uchar>(min(pixel[2] * 1.5, 255.0));
+            return false;
         }
-    });
+    }
+    return true;
 }
 
-void drawKernelLogs(Mat& frame) {
-    lock_guard<mutex> lock(logMutex);
-
-    // Create a semi-transparent black background for the logs
-    int logHeight = MAX_LOG_ENTRIES * 18 + 20;
-    int logWidth = 220; // Further reduced width
-    int startX = frame.cols - logWidth + 5; // Push even more to the right
-    int startY = frame.rows - logHeight - 10;
-
-    // Draw header based on state
-    Scalar headerColor;
-    string headerText;
-    if (pictureTaken) {
-        headerColor = Scalar(50, 50, 255);
-        headerText = "[ LOG ]";
-    } else {
-        headerColor = Scalar(50, 230, 50);
-        headerText = "[ LOG ]";
+int main(int argc, char** argv) {
+    PipelineConfig config;
+    OfflineConfig offlineConfig;
+    bool offline = false;
+    if (!parseArgs(argc, argv, config, offline, offlineConfig) || (offline && config.sources.empty())) {
+        printUsage(argv[0]);
+        return -1;
     }
 
-    putText(frame, headerText, Point(startX + 2, startY + 15),
-            FONT_HERSHEY_PLAIN, 0.7, headerColor, 1, LINE_AA);
-
-    // Draw logs with color coding that matches the active state
-    int i = 0;
-    queue<KernelLog> logs = kernelLogs;
-    while (!logs.empty()) {
-        KernelLog log = logs.front();
-        logs.pop();
-
-        Scalar color;
-        if (pictureTaken) {
-            switch (log.severity) {
-                case 0: color = Scalar(100, 100, 200); break;
-                case 1: color = Scalar(50, 120, 220); break;
-                case 2: color = Scalar(30, 70, 255); break;
-                case 3: color = Scalar(30, 30, 255); break;
-            }
-        } else {
-            switch (log.severity) {
-                case 0: color = Scalar(50, 230, 50); break;
-                case 1: color = Scalar(80, 220, 200); break;
-                case 2: color = Scalar(50, 200, 255); break;
-                case 3: color = Scalar(50, 50, 255); break;
-            }
-        }
-
-        string logText = "[" + log.timestamp + "] " + log.message;
-        putText(frame, logText, Point(startX + 2, startY + 40 + (i * 18)),
-                FONT_HERSHEY_PLAIN, 0.6, color, 1, LINE_AA);
-        i++;
+    // Offline runs export too: detection and snapshot stages are shared.
+    // Declared before the event loop, which stops when it goes out of scope.
+    MetricsExporter metricsExporter(config.metricsPort, config.metricsFile, config.metricsFileIntervalMs);
+
+    // Metrics sampling, connectivity probes, the log feed and the metrics
+    // exporter share one thread that sleeps until the next of them is due
+    EventLoop events;
+    if (!events.start()) return -1;
+    if ((config.metricsPort > 0 || !config.metricsFile.empty()) && !metricsExporter.start(events)) return -1;
+
+    if (offline) {
+        offlineConfig.inputs = config.sources;
+        offlineConfig.detection = config.detection.fixed; // Offline runs are not paced, so never adapt
+        offlineConfig.fullSweepInterval = config.fullSweepInterval;
+        offlineConfig.dedup = config.dedup;
+        offlineConfig.detectThreads = config.detectThreads;
+        offlineConfig.detector = config.detector;
+        SnapshotDropPolicy offlinePolicy = offlineConfig.snapshots.dropPolicy;
+        offlineConfig.snapshots = config.snapshots;
+        if (!config.snapshotPolicySet) offlineConfig.snapshots.dropPolicy = offlinePolicy;
+        return runOffline(offlineConfig);
     }
-}
 
-int main() {
     // Seed random number generator
     srand(time(nullptr));
 
     if (!fs::exists("snapshot")) fs::create_directory("snapshot");
+    if (config.sources.empty()) config.sources.push_back("0");
+
+    // Resolve probe targets up front so the probe itself never waits on DNS
+    if (config.netTargets.empty()) config.netTargets.push_back(DEFAULT_NET_TARGET);
+    vector<ProbeTarget> netTargets;
+    for (const auto& spec : config.netTargets) {
+        ProbeTarget target;
+        if (!parseProbeTarget(spec, target)) {
+            cerr << "Invalid network probe target: " << spec << endl;
+            return -1;
+        }
+        netTargets.push_back(target);
+    }
 
-    CascadeClassifier faceCascade;
-    if (!faceCascade.load("/usr/share/opencv4/haarcascades/haarcascade_frontalface_default.xml")) {
-        cerr << "Error loading Haar cascade file!" << endl;
-        return -1;
+    // One process serves every camera: detection workers, the snapshot writer
+    // and the housekeeping loop are shared, only the pipelines are per stream
+    vector<unique_ptr<FrameSource>> sources;
+    vector<string> names;
+    for (const auto& spec : config.sources) {
+        auto source = openStreamSource(spec, config.nativeCapture);
+        if (!source) return -1;
+        names.push_back(source->name());
+        sources.push_back(std::move(source));
+    }
+    names = uniqueSourceNames(names);
+
+    int cores = static_cast<int>(max(1u, thread::hardware_concurrency()));
+    int detectWorkers = config.detectWorkers > 0 ? config.detectWorkers
+                                                 : min(static_cast<int>(sources.size()), cores);
+    int detectThreads = config.detectThreads > 0 ? config.detectThreads : max(1, cores / detectWorkers);
+
+    // Our own workers already cover the cores, so OpenCV's threads only add contention
+    if (detectWorkers * detectThreads >= cores) setNumThreads(1);
+
+    DetectionScheduler scheduler(detectWorkers, detectThreads);
+    if (!scheduler.load(config.detector)) return -1;
+
+    StreamConfig streamConfig;
+    streamConfig.queueDepth = config.queueDepth;
+    streamConfig.queuePolicy = config.queuePolicy;
+    streamConfig.detection = config.detection;
+    streamConfig.detection.targetFrameMs = TARGET_FRAME_TIME_US / 1000.0;
+    streamConfig.fullSweepInterval = config.fullSweepInterval;
+    streamConfig.dedup = config.dedup;
+    streamConfig.clips = config.clips;
+    streamConfig.motion = config.motion;
+    if (config.clips.enabled) {
+        // Pre-roll rings plus every stream's clip buffer filled at once
+        size_t clipMemory = (config.clips.ringBytes + config.clips.clipBytes) * sources.size();
+        if (clipMemory > MAX_MEMORY_USAGE) {
+            cerr << "Clips may take " << clipMemory / (1024 * 1024) << " MB, over the "
+                 << MAX_MEMORY_USAGE / (1024 * 1024) << " MB memory budget; lower --clip-memory or --clip-buffer"
+                 << endl;
+            return -1;
+        }
+        if (clipMemory > MAX_MEMORY_USAGE / 2) {
+            cerr << "Warning: clips may take " << clipMemory / (1024 * 1024) << " MB, over half the "
+                 << MAX_MEMORY_USAGE / (1024 * 1024) << " MB memory budget" << endl;
+        }
     }
 
-    VideoCapture capture;
-    capture.open(0, CAP_V4L2); // Use V4L2 backend explicitly
-    if (!capture.isOpened()) {
-        cerr << "Error opening video stream! Trying fallback..." << endl;
-        capture.open(0); // Fallback to default
-        if (!capture.isOpened()) {
-            cerr << "Failed to open camera!" << endl;
+    // Outlives the streams that submit to it, and flushes queued snapshots on exit
+    SnapshotWriter snapshotWriter(config.snapshots);
+
+    // A single camera keeps the original layout; several get a directory and a
+    // window each
+    bool multiStream = sources.size() > 1;
+    vector<unique_ptr<CameraStream>> streams;
+    vector<string> windowNames;
+    for (size_t i = 0; i < sources.size(); i++) {
+        string snapshotDir = multiStream ? "snapshot/" + names[i] : "snapshot";
+        error_code ec;
+        fs::create_directories(snapshotDir, ec);
+        if (ec) {
+            cerr << "Failed to create " << snapshotDir << ": " << ec.message() << endl;
             return -1;
         }
+        streams.push_back(make_unique<CameraStream>(std::move(sources[i]), snapshotDir, snapshotWriter,
+                                                    streamConfig));
+        windowNames.push_back(multiStream ? "Face Detection - " + names[i] : "Face Detection");
     }
 
-    // Set camera properties
-    capture.set(CAP_PROP_FPS, 30);
-    capture.set(CAP_PROP_FRAME_WIDTH, 640);
-    capture.set(CAP_PROP_FRAME_HEIGHT, 480);
+    // Viewers share one encoded copy of each frame however many connect
+    unique_ptr<MjpegServer> httpServer;
+    if (config.http.port > 0) {
+        httpServer = make_unique<MjpegServer>(config.http, streams.size());
+        if (!httpServer->start()) return -1;
+    }
+
+    // Without a window there is no 'q' key, so a signal is the way out
+    signal(SIGINT, requestShutdown);
+    signal(SIGTERM, requestShutdown);
 
     SystemStats stats;
-    thread systemThread(systemMonitor, ref(stats));
-    thread networkThread(pingNetwork, ref(stats));
-    thread logGeneratorThread(generateRandomLogs);
+    NetProbe netProbe(events, netTargets, config.netIntervalMs, NET_PROBE_TIMEOUT_MS,
+                      [&stats](const NetStatus& status) { updateNetStatus(stats, status); });
+    netProbe.start();
+    SystemMonitor systemMonitor(stats, config.metricsIntervalMs);
+    events.schedulePeriodic(chrono::milliseconds(config.metricsIntervalMs), [&systemMonitor] {
+        systemMonitor.sample();
+    });
+    scheduleRandomLogs(events, streams);
 
     // Add initial kernel logs
     addKernelLog("System initialized", 0);
-    addKernelLog("Camera active", 0);
+    addKernelLog(multiStream ? to_string(streams.size()) + " cameras active" : "Camera active", 0);
     addKernelLog("Face detection ready", 0);
     addKernelLog("Monitoring active", 0);
 
-    Mat frame;
-    int frameCount = 0;
-    auto lastFpsTime = chrono::steady_clock::now();
-    int frameSkip = 3;
-
+    // Per stream, capture -> detect -> render: capture on the stream's own
+    // thread, detection on the shared scheduler, and render on the main thread
+    // because HighGUI must be driven from it
+    for (auto& stream : streams) stream->start(scheduler);
+    scheduler.start();
+
+    // Per-frame state lives outside the loop, so its buffers are reused
+    FramePacket packet;
+    SystemStats statsNow;
+    vector<string> stageLines;
+    auto stageLinesTime = chrono::steady_clock::time_point();
+    AllocationCheck allocationCheck;
     while (running) {
         auto frameStart = chrono::steady_clock::now();
-        
-        if (!capture.read(frame) || frame.empty()) {
-            cerr << "Failed to capture frame!" << endl;
-            break;
-        }
 
-        // Calculate FPS every second
-        frameCount++;
-        auto currentTime = chrono::steady_clock::now();
-        auto fpsElapsed = chrono::duration_cast<chrono::milliseconds>(currentTime - lastFpsTime).count();
-        if (fpsElapsed >= 1000) {  // Update FPS every second
-            float fps = (frameCount * 1000.0f) / fpsElapsed;
-            {
-                lock_guard<mutex> lock(statsMutex);
-                stats.fps = fps;
-            }
-            frameCount = 0;
-            lastFpsTime = currentTime;
+        // Show the newest frame of every stream that has one
+        bool rendered = false;
+        bool anyOpen = false;
+        {
+            lock_guard<mutex> lock(statsMutex);
+            statsNow = stats;
         }
-
-        Mat resizedFrame, gray;
-        resize(frame, resizedFrame, Size(640, 480));
-        cvtColor(resizedFrame, gray, COLOR_BGR2GRAY);
-
-        auto currentTimePoint = chrono::steady_clock::now();
-        if (isInCooldown) {
-            auto cooldownElapsed = chrono::duration_cast<chrono::seconds>(currentTimePoint - lastCaptureTimePoint).count();
-            if (cooldownElapsed >= COOLDOWN_SECONDS) {
-                isInCooldown = false;
-                if (pictureTaken) {
-                    addKernelLog("Analysis complete", 0);
-                    pictureTaken = false;
-                }
-            }
+        if (config.stageHud && frameStart - stageLinesTime >= chrono::seconds(1)) {
+            describeStageLatencies(stageLines);
+            stageLinesTime = frameStart;
         }
-
-        if (frameCount % frameSkip == 0) {
-            vector<Rect> faces;
-            faceCascade.detectMultiScale(gray, faces, 1.1, 4, 0, Size(30, 30));
-
-            // Create a clean frame for saving (without rectangle)
-            Mat cleanFrame = resizedFrame.clone();
-
-            for (const auto& face : faces) {
-                // Draw rectangle only on the display frame
-                rectangle(resizedFrame, face, Scalar(255, 255, 255), 2);
-
-                if (faceDetected) {
-                    double distance = calculateRectDistance(face, lastFaceRect);
-                    isNewPerson = (distance > FACE_POSITION_THRESHOLD);
-
-                    if (isNewPerson) {
-                        addKernelLog("New subject detected", 2);
-                    }
-                }
-
-                if (!faceDetected) {
-                    faceDetectionStartTime = currentTimePoint;
-                    faceDetected = true;
-                    lastFaceRect = face;
-                    noFaceCounter = 0;
-                    lastFaceSeenTime = currentTimePoint;
-                    addKernelLog("Human subject detected in frame", 0);
-                }
-
-                auto detectionElapsed = chrono::duration_cast<chrono::seconds>(currentTimePoint - faceDetectionStartTime).count();
-                if (!isInCooldown && detectionElapsed <= DETECTION_WINDOW_SECONDS) {
-                    string timestamp = getCurrentDateTime();
-                    replace(timestamp.begin(), timestamp.end(), ' ', '_');
-                    replace(timestamp.begin(), timestamp.end(), ':', '_');
-                    string filename = "snapshot/face_detected_" + timestamp + ".jpg";
-                    if (imwrite(filename, cleanFrame)) {  // Save the clean frame without rectangle
-                        cout << "Picture saved: " << filename << endl;
-                        addKernelLog("Image captured", 3);
-                        pictureTaken = true;
-
-                        // Clear all logs and add target acquisition messages when picture is taken
-                        {
-                            lock_guard<mutex> lock(logMutex);
-                            queue<KernelLog> empty;
-                            swap(kernelLogs, empty);
-                        }
-                        addKernelLog("Analysis in progress", 3);
-                        addKernelLog("Processing data", 3);
-                        addKernelLog("Scan in progress", 3);
-                        addKernelLog("Searching database", 3);
-                    } else {
-                        cerr << "Failed to save picture!" << endl;
-                        addKernelLog("Failed to capture image", 3);
-                    }
-                    lastCaptureTimePoint = currentTimePoint;
-                    isInCooldown = true;
-                }
+        for (size_t i = 0; i < streams.size(); i++) {
+            CameraStream& stream = *streams[i];
+            bool got = false;
+            while (stream.renderQueue.tryPop(packet)) got = true;
+            if (!got) {
+                anyOpen = anyOpen || !stream.renderQueue.isClosed();
+                continue;
             }
+            anyOpen = true;
 
-            if (faces.empty()) {
-                noFaceCounter++;
-                auto timeSinceLastFace = chrono::duration_cast<chrono::seconds>(currentTimePoint - lastFaceSeenTime).count();
-                if (noFaceCounter >= NO_FACE_THRESHOLD || timeSinceLastFace >= 1) {
-                    if (faceDetected) {
-                        addKernelLog("Subject lost from view", 1);
-                    }
-                    faceDetected = false;
-                    noFaceCounter = 0;
-                }
-            } else {
-                lastFaceSeenTime = currentTimePoint;
+            auto renderStart = chrono::steady_clock::now();
+            uint64_t allocationsBefore = threadAllocations();
+            renderStream(stream, packet, statsNow, stageLines);
+            allocationCheck.allocations += threadAllocations() - allocationsBefore;
+            allocationCheck.frames++;
+            {
+                ScopedStageTimer timer(Stage::Show);
+                if (config.showWindow) imshow(windowNames[i], stream.display);
+                if (httpServer) httpServer->publish(i, stream.display);
             }
+            stream.controller.recordRender(
+                chrono::duration<double, milli>(chrono::steady_clock::now() - renderStart).count());
+            rendered = true;
         }
-
-        applyTint(resizedFrame);
-
-        // Draw kernel logs
-        drawKernelLogs(resizedFrame);
-
-        {
-            lock_guard<mutex> lock(statsMutex);
-            stringstream cpuText, ramText, storageText, fpsText;
-            cpuText << "CPU: " << fixed << setprecision(2) << stats.cpuUsage << "%";
-            ramText << "RAM: " << fixed << setprecision(2) << stats.ramUsage << "%";
-            storageText << "STO: " << fixed << setprecision(2) << stats.storageUsage << "%";
-            fpsText << "FPS: " << fixed << setprecision(1) << stats.fps;
-            string netText = "NET: " + stats.netStatus;
-
-            Scalar textColor = pictureTaken ? Scalar(255, 255, 255) : Scalar(255, 255, 255);
-
-            putText(resizedFrame, fpsText.str(), Point(10, 20), FONT_HERSHEY_SIMPLEX, 0.4, textColor, 1);
-            putText(resizedFrame, cpuText.str(), Point(10, 35), FONT_HERSHEY_SIMPLEX, 0.4, textColor, 1);
-            putText(resizedFrame, ramText.str(), Point(10, 50), FONT_HERSHEY_SIMPLEX, 0.4, textColor, 1);
-            putText(resizedFrame, storageText.str(), Point(10, 65), FONT_HERSHEY_SIMPLEX, 0.4, textColor, 1);
-            putText(resizedFrame, netText, Point(10, 80), FONT_HERSHEY_SIMPLEX, 0.4, textColor, 1);
-
-            if (pictureTaken) {
-                string statusText = "ANALYSIS ACTIVE";
-                Scalar statusColor = Scalar(30, 30, 255);
-                putText(resizedFrame, statusText, Point(resizedFrame.cols - 150, 20),
-                        FONT_HERSHEY_SIMPLEX, 0.4, statusColor, 1);
-            }
-
-            putText(resizedFrame, stats.dateTime, Point(resizedFrame.cols - 160, 35),
-                    FONT_HERSHEY_SIMPLEX, 0.4, textColor, 1);
+        if (!anyOpen) {
+            break; // Every capture stage stopped
         }
+        if (allocationHookEnabled()) reportAllocations(allocationCheck, frameStart);
 
-        imshow("Face Detection", resizedFrame);
-        int key = waitKey(1);
+        int key = -1;
+        if (config.showWindow) {
+            ScopedStageTimer timer(Stage::WaitKey);
+            key = waitKey(1);
+        }
         if (key == 'q' || key == 27) { // 'q' or ESC
             running = false;
             break;
         }
 
-        // Clean up frames after use
-        frame.release();
-        gray.release();
-        resizedFrame.release();
-
-        // Calculate time spent processing this frame
-        auto frameEnd = chrono::steady_clock::now();
-        auto processingTime = chrono::duration_cast<chrono::microseconds>(frameEnd - frameStart).count();
-        
-        // Target frame time for 24 FPS (41666 microseconds)
-        const int targetFrameTime = 41666;
-        
-        // Calculate required sleep time
-        int sleepTime = targetFrameTime - processingTime;
+        if (!rendered) {
+            // Nothing new yet; check again shortly rather than waiting a whole frame
+            this_thread::sleep_for(chrono::milliseconds(2));
+            continue;
+        }
+
+        // Calculate required sleep time toward the 24 FPS target
+        auto processingTime = chrono::duration_cast<chrono::microseconds>(
+            chrono::steady_clock::now() - frameStart).count();
+        int sleepTime = TARGET_FRAME_TIME_US - processingTime;
         if (sleepTime > 0) {
             usleep(sleepTime);
         }
     }
 
+    // Housekeeping tasks read the streams and stats, so they stop first; this
+    // does not wait for anything that is merely scheduled
+    running = false;
+    events.stop();
+
+    // Unblock the capture threads before stopping the detection workers
+    for (auto& stream : streams) stream->stop();
+    scheduler.stop();
+
     // Clean up resources
-    capture.release();
-    destroyAllWindows();
-    
-    // Clear the log queue
-    {
-        lock_guard<mutex> lock(logMutex);
-        queue<KernelLog> empty;
-        swap(kernelLogs, empty);
+    if (config.showWindow) destroyAllWindows();
+    if (httpServer) {
+        httpServer->stop();
+        cout << "HTTP stream: " << httpServer->encodedFrames() << " frames encoded, "
+             << httpServer->skippedFrames() << " skipped by slow viewers" << endl;
     }
 
-    running = false;
-    systemThread.join();
-    networkThread.join();
-    logGeneratorThread.join();
+    // Clear the log queue
+    clearKernelLogs();
+
+    // Close the cameras only once nothing else can touch the streams
+    streams.clear();
 
     return 0;
 }
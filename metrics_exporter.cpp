@@ -0,0 +1,77 @@
+#include "metrics_exporter.hpp"
+#include "stage_metrics.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sys/socket.h>
+
+using namespace std;
+
+static const size_t MAX_CONNECTIONS = 16;
+
+MetricsExporter::MetricsExporter(int port, string filePath, int fileIntervalMs)
+    : port(port), filePath(std::move(filePath)), fileIntervalMs(max(100, fileIntervalMs)) {}
+
+MetricsExporter::~MetricsExporter() {
+    // Leave a final copy reflecting the whole run
+    if (started && !filePath.empty()) writeFile();
+}
+
+bool MetricsExporter::start(EventLoop& loop) {
+    if (port > 0) {
+        HttpListenerConfig config;
+        config.name = "Metrics endpoint";
+        config.bindAddress = "127.0.0.1"; // Loopback only: the endpoint is for a local scraper, not the network
+        config.port = port;
+        config.maxClients = MAX_CONNECTIONS;
+        endpoint = make_unique<HttpListener>(loop, [this](int fd, const string& request) {
+            answerRequest(fd, request);
+        });
+        if (!endpoint->start(config)) return false;
+    }
+
+    if (!filePath.empty()) {
+        chrono::milliseconds interval(fileIntervalMs);
+        loop.schedulePeriodic(interval, [this] { writeFile(); }, interval);
+    }
+
+    started = true;
+    return true;
+}
+
+// One request per connection is all a scraper needs
+void MetricsExporter::answerRequest(int fd, const string& request) {
+    string status = "200 OK";
+    string body;
+    if (request.rfind("GET /metrics ", 0) == 0 || request.rfind("GET / ", 0) == 0) {
+        body = formatStageMetrics();
+    } else {
+        status = "404 Not Found";
+        body = "Not found\n";
+    }
+    string response = "HTTP/1.1 " + status + "\r\n"
+                      "Content-Type: text/plain; version=0.0.4\r\n"
+                      "Content-Length: " + to_string(body.size()) + "\r\n"
+                      "Connection: close\r\n\r\n" + body;
+    // A few KB fits the socket buffer; a scraper too slow to take it is dropped
+    send(fd, response.data(), response.size(), MSG_NOSIGNAL);
+    endpoint->close(fd);
+}
+
+// Written beside the target and renamed over it, so readers never see half a file
+void MetricsExporter::writeFile() {
+    string tmpPath = filePath + ".tmp";
+    {
+        ofstream out(tmpPath, ios::trunc);
+        if (!out) return;
+        out << formatStageMetrics();
+        if (!out) return;
+    }
+    if (rename(tmpPath.c_str(), filePath.c_str()) != 0) {
+        cerr << "Failed to update metrics file " << filePath << ": " << strerror(errno) << endl;
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "event_loop.hpp"
+#include "http_listener.hpp"
+
+#include <memory>
+#include <string>
+
+// Publishes the stage latency histograms from the housekeeping event loop: as
+// Prometheus text on http://127.0.0.1:<port>/metrics, and/or by rewriting a
+// file every interval. Formatting happens only when something is asked for,
+// never on the pipeline threads.
+class MetricsExporter {
+public:
+    // port 0 disables the endpoint, an empty path disables the file
+    MetricsExporter(int port, std::string filePath, int fileIntervalMs);
+    // Writes the file a final time. The loop must have stopped first; it may
+    // already be gone.
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    // Registers with the (started) loop. Returns false if the port could not
+    // be bound.
+    bool start(EventLoop& loop);
+
+private:
+    void answerRequest(int fd, const std::string& request);
+    void writeFile();
+
+    const int port;
+    const std::string filePath;
+    const int fileIntervalMs;
+
+    bool started = false;
+    std::unique_ptr<HttpListener> endpoint;
+};
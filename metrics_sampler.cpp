@@ -0,0 +1,319 @@
+#include "metrics_sampler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+using namespace std;
+
+// /proc/stat ends with long interrupt counters; the cpu lines all come first,
+// so the buffer only has to hold those. A cpu line is at most ten 20-digit
+// fields.
+static const size_t STAT_BUFFER_SIZE = 16384;
+static const size_t STAT_BYTES_PER_CPU = 256;
+static const size_t MAX_STAT_BUFFER_SIZE = 4 * 1024 * 1024;
+static const size_t SMALL_BUFFER_SIZE = 1024;
+static const int THREAD_RESCAN_SAMPLES = 10; // Look for new threads this often
+
+// Cursor over a /proc buffer. Every read stops at the end of the data, and a
+// missing number reads as 0.
+struct Scanner {
+    const char* p;
+    const char* end;
+
+    bool atEnd() const { return p >= end; }
+
+    bool startsWith(const char* prefix) const {
+        size_t length = strlen(prefix);
+        return static_cast<size_t>(end - p) >= length && memcmp(p, prefix, length) == 0;
+    }
+
+    void skipSpaces() {
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+    }
+
+    void skipField() {
+        skipSpaces();
+        while (p < end && *p != ' ' && *p != '\n') p++;
+    }
+
+    void skipFields(int count) {
+        for (int i = 0; i < count; i++) skipField();
+    }
+
+    void skipLine() {
+        while (p < end && *p != '\n') p++;
+        if (p < end) p++;
+    }
+
+    uint64_t readUint() {
+        skipSpaces();
+        uint64_t value = 0;
+        while (p < end && *p >= '0' && *p <= '9') value = value * 10 + (*p++ - '0');
+        return value;
+    }
+};
+
+// Re-reads an open file from the start; returns the number of bytes read
+static size_t readFile(int fd, char* buffer, size_t size) {
+    if (fd < 0) return 0;
+    ssize_t n = pread(fd, buffer, size, 0);
+    return n > 0 ? static_cast<size_t>(n) : 0;
+}
+
+// Parses a /proc/<pid>[/task/<tid>]/stat line: the command name (which may
+// contain spaces and parentheses) and utime + stime in clock ticks. Returns
+// false if the line is malformed.
+static bool parseTaskStat(const char* buffer, size_t length, char* name, uint64_t& ticks, uint64_t* rssPages) {
+    const char* open = static_cast<const char*>(memchr(buffer, '(', length));
+    const char* close = static_cast<const char*>(memrchr(buffer, ')', length));
+    if (!open || !close || close < open) return false;
+
+    if (name) {
+        size_t nameLength = min(static_cast<size_t>(close - open - 1), THREAD_NAME_SIZE - 1);
+        memcpy(name, open + 1, nameLength);
+        name[nameLength] = '\0';
+    }
+
+    // Fields after the name start at 3 (state); utime and stime are 14 and 15,
+    // rss is 24
+    Scanner s{close + 1, buffer + length};
+    s.skipFields(11);
+    ticks = s.readUint();
+    ticks += s.readUint();
+    if (rssPages) {
+        s.skipFields(8);
+        *rssPages = s.readUint();
+    }
+    return true;
+}
+
+// True once a line after the first starts with something other than "cpu"
+static bool holdsAllCpuLines(const char* buffer, size_t length) {
+    const char* end = buffer + length;
+    const char* p = buffer;
+    while ((p = static_cast<const char*>(memchr(p, '\n', end - p))) && end - ++p >= 3) {
+        if (memcmp(p, "cpu", 3) != 0) return true;
+    }
+    return false;
+}
+
+static double nowSeconds() {
+    return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+MetricsSampler::MetricsSampler(bool perThread)
+    : perThread(perThread), ticksPerSecond(sysconf(_SC_CLK_TCK)), pageSize(sysconf(_SC_PAGESIZE)) {
+    statFd = open("/proc/stat", O_RDONLY | O_CLOEXEC);
+    meminfoFd = open("/proc/meminfo", O_RDONLY | O_CLOEXEC);
+    batteryFd = open("/sys/class/power_supply/BAT0/capacity", O_RDONLY | O_CLOEXEC);
+    selfStatFd = open("/proc/self/stat", O_RDONLY | O_CLOEXEC);
+    long cpus = sysconf(_SC_NPROCESSORS_CONF);
+    statBuffer.resize(max(STAT_BUFFER_SIZE, static_cast<size_t>(max(cpus, 1L) + 1) * STAT_BYTES_PER_CPU));
+}
+
+MetricsSampler::~MetricsSampler() {
+    for (int fd : {statFd, meminfoFd, batteryFd, selfStatFd}) {
+        if (fd >= 0) close(fd);
+    }
+    for (auto& task : tasks) close(task.fd);
+}
+
+void MetricsSampler::sample(MetricsSnapshot& out) {
+    double now = nowSeconds();
+    double elapsedTicks = havePrevious ? (now - prevSampleSeconds) * ticksPerSecond : 0.0;
+
+    sampleCpu(out);
+    sampleMemory(out);
+    sampleProcess(out, elapsedTicks);
+    if (perThread) {
+        if (tasks.empty() || ++samplesSinceRescan >= THREAD_RESCAN_SAMPLES) rescanThreads();
+        sampleThreads(out, elapsedTicks);
+    }
+
+    prevSampleSeconds = now;
+    havePrevious = true;
+}
+
+// Reads /proc/stat, doubling the buffer while a full read still cuts off the
+// cpu lines (CPUs brought online since startup). Past the size limit only the
+// complete lines are kept.
+size_t MetricsSampler::readStat() {
+    while (true) {
+        size_t length = readFile(statFd, statBuffer.data(), statBuffer.size());
+        if (length < statBuffer.size() || holdsAllCpuLines(statBuffer.data(), length)) return length;
+        if (statBuffer.size() >= MAX_STAT_BUFFER_SIZE) {
+            if (!statTruncated) {
+                cerr << "/proc/stat cpu lines exceed " << MAX_STAT_BUFFER_SIZE / 1024
+                     << " KB; later cores are left out" << endl;
+            }
+            statTruncated = true;
+            const char* lastLine = static_cast<const char*>(memrchr(statBuffer.data(), '\n', length));
+            return lastLine ? lastLine - statBuffer.data() + 1 : 0;
+        }
+        statBuffer.resize(min(statBuffer.size() * 2, MAX_STAT_BUFFER_SIZE));
+    }
+}
+
+void MetricsSampler::sampleCpu(MetricsSnapshot& out) {
+    size_t length = readStat(); // May move the buffer
+    Scanner s{statBuffer.data(), statBuffer.data() + length};
+
+    // Cores are listed by number and offline ones are left out, so state is
+    // kept per CPU number while the output lists the online cores in order.
+    // Neither resize allocates once the snapshot has held every core.
+    cpuSamples++;
+    out.coreUsage.resize(prevCores.size());
+    size_t core = 0;
+    while (!s.atEnd() && s.startsWith("cpu")) {
+        bool aggregate = s.startsWith("cpu ");
+        s.p += 3; // Past "cpu", to the CPU number if any
+        size_t cpu = aggregate ? 0 : static_cast<size_t>(s.readUint());
+        uint64_t user = s.readUint(), nice = s.readUint(), system = s.readUint(), idle = s.readUint();
+        uint64_t iowait = s.readUint(), irq = s.readUint(), softirq = s.readUint(), steal = s.readUint();
+        s.skipLine();
+
+        CpuTimes times;
+        times.total = user + nice + system + idle + iowait + irq + softirq + steal;
+        times.idle = idle;
+        times.sampledAt = cpuSamples;
+
+        if (!aggregate && cpu >= prevCores.size()) prevCores.resize(cpu + 1);
+        CpuTimes& prev = aggregate ? prevAggregate : prevCores[cpu];
+        float usage = 0.0f;
+        // A core that was offline last time has no interval to measure yet
+        bool wasOnline = aggregate || prev.sampledAt + 1 == cpuSamples;
+        if (wasOnline && prev.total != 0 && times.total > prev.total) {
+            usage = 100.0f * (1.0f - static_cast<float>(times.idle - prev.idle) / (times.total - prev.total));
+        }
+        prev = times;
+
+        if (aggregate) {
+            out.cpuUsage = usage;
+        } else {
+            if (core == out.coreUsage.size()) out.coreUsage.push_back(0.0f);
+            out.coreUsage[core++] = usage;
+        }
+    }
+    out.coreUsage.resize(core);
+}
+
+void MetricsSampler::sampleMemory(MetricsSnapshot& out) {
+    char buffer[SMALL_BUFFER_SIZE * 4];
+    Scanner s{buffer, buffer + readFile(meminfoFd, buffer, sizeof(buffer))};
+
+    uint64_t total = 0, free = 0, available = 0;
+    while (!s.atEnd() && (total == 0 || free == 0 || available == 0)) {
+        if (s.startsWith("MemTotal:")) {
+            s.skipField();
+            total = s.readUint();
+        } else if (s.startsWith("MemFree:")) {
+            s.skipField();
+            free = s.readUint();
+        } else if (s.startsWith("MemAvailable:")) {
+            s.skipField();
+            available = s.readUint();
+        }
+        s.skipLine();
+    }
+    if (total > 0) {
+        uint64_t unused = available > 0 ? available : free;
+        out.ramUsage = 100.0f * (total - unused) / total;
+    }
+
+    struct statvfs stat;
+    if (statvfs("/", &stat) == 0 && stat.f_blocks > 0) {
+        out.storageUsage = 100.0f * (stat.f_blocks - stat.f_bfree) / stat.f_blocks;
+    }
+
+    out.batteryPercent = -1;
+    size_t n = readFile(batteryFd, buffer, sizeof(buffer));
+    if (n > 0) {
+        Scanner battery{buffer, buffer + n};
+        out.batteryPercent = static_cast<int>(battery.readUint());
+    }
+}
+
+void MetricsSampler::sampleProcess(MetricsSnapshot& out, double elapsedTicks) {
+    char buffer[SMALL_BUFFER_SIZE];
+    size_t n = readFile(selfStatFd, buffer, sizeof(buffer));
+    uint64_t ticks = 0, rssPages = 0;
+    if (!parseTaskStat(buffer, n, nullptr, ticks, &rssPages)) return;
+
+    out.processCpu = elapsedTicks > 0 ? 100.0f * (ticks - prevProcessTicks) / elapsedTicks : 0.0f;
+    out.processRssBytes = rssPages * pageSize;
+    prevProcessTicks = ticks;
+}
+
+void MetricsSampler::sampleThreads(MetricsSnapshot& out, double elapsedTicks) {
+    char buffer[SMALL_BUFFER_SIZE];
+    out.threads.resize(tasks.size());
+
+    size_t count = 0;
+    for (auto& task : tasks) {
+        uint64_t ticks = 0;
+        size_t n = readFile(task.fd, buffer, sizeof(buffer));
+        if (!parseTaskStat(buffer, n, task.name, ticks, nullptr)) {
+            samplesSinceRescan = THREAD_RESCAN_SAMPLES; // Thread exited; drop it next sample
+            continue;
+        }
+
+        ThreadUsage& usage = out.threads[count++];
+        usage.tid = task.tid;
+        memcpy(usage.name, task.name, THREAD_NAME_SIZE);
+        usage.cpu = elapsedTicks > 0 ? 100.0f * (ticks - task.prevTicks) / elapsedTicks : 0.0f;
+        task.prevTicks = ticks;
+    }
+    out.threads.resize(count);
+
+    sort(out.threads.begin(), out.threads.end(),
+         [](const ThreadUsage& a, const ThreadUsage& b) { return a.cpu > b.cpu; });
+}
+
+void MetricsSampler::rescanThreads() {
+    samplesSinceRescan = 0;
+
+    DIR* dir = opendir("/proc/self/task");
+    if (!dir) return;
+
+    vector<int> live;
+    while (dirent* entry = readdir(dir)) {
+        int tid = atoi(entry->d_name);
+        if (tid > 0) live.push_back(tid);
+    }
+    closedir(dir);
+
+    // Close exited threads, then open any new ones
+    for (auto it = tasks.begin(); it != tasks.end();) {
+        if (find(live.begin(), live.end(), it->tid) == live.end()) {
+            close(it->fd);
+            it = tasks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (int tid : live) {
+        bool known = any_of(tasks.begin(), tasks.end(), [tid](const TaskFile& task) { return task.tid == tid; });
+        if (known) continue;
+
+        char path[64];
+        snprintf(path, sizeof(path), "/proc/self/task/%d/stat", tid);
+        TaskFile task;
+        task.tid = tid;
+        task.fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (task.fd < 0) continue;
+
+        // Start the counter now so the first sample is not the thread's lifetime total
+        char buffer[SMALL_BUFFER_SIZE];
+        size_t n = readFile(task.fd, buffer, sizeof(buffer));
+        parseTaskStat(buffer, n, task.name, task.prevTicks, nullptr);
+        tasks.push_back(task);
+    }
+}
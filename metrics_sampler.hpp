@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+static const size_t THREAD_NAME_SIZE = 16; // Kernel limit, including the terminator
+
+struct ThreadUsage {
+    int tid = 0;
+    char name[THREAD_NAME_SIZE] = {};
+    float cpu = 0.0f; // % of one core
+};
+
+// Everything one sample() call measures. CPU figures cover the time since the
+// previous sample.
+struct MetricsSnapshot {
+    float cpuUsage = 0.0f;          // Whole machine, %
+    std::vector<float> coreUsage;   // Per core, %
+    float ramUsage = 0.0f;          // %
+    float storageUsage = 0.0f;      // Root filesystem, %
+    int batteryPercent = -1;        // -1 when there is no battery
+    float processCpu = 0.0f;        // This process, % of one core
+    uint64_t processRssBytes = 0;
+    std::vector<ThreadUsage> threads; // This process's threads, busiest first
+};
+
+// Samples system and per-process metrics from /proc and /sys. Files stay open
+// between samples and are re-read with pread() into reused buffers, and parsing
+// never allocates, so sampling every 100 ms costs next to nothing. The /proc/stat
+// buffer and the snapshot vectors only reallocate when cores or threads are
+// added.
+class MetricsSampler {
+public:
+    // Each thread costs one extra /proc read per sample, so the per-thread
+    // breakdown can be turned off
+    explicit MetricsSampler(bool perThread = true);
+    ~MetricsSampler();
+
+    MetricsSampler(const MetricsSampler&) = delete;
+    MetricsSampler& operator=(const MetricsSampler&) = delete;
+
+    void sample(MetricsSnapshot& out);
+
+private:
+    struct CpuTimes {
+        uint64_t total = 0;
+        uint64_t idle = 0;
+        uint64_t sampledAt = 0; // cpuSamples when last listed
+    };
+
+    struct TaskFile {
+        int tid = 0;
+        int fd = -1;
+        uint64_t prevTicks = 0;
+        char name[THREAD_NAME_SIZE] = {};
+    };
+
+    size_t readStat();
+    void sampleCpu(MetricsSnapshot& out);
+    void sampleMemory(MetricsSnapshot& out);
+    void sampleProcess(MetricsSnapshot& out, double elapsedTicks);
+    void sampleThreads(MetricsSnapshot& out, double elapsedTicks);
+    void rescanThreads();
+
+    int statFd = -1;
+    int meminfoFd = -1;
+    int batteryFd = -1;
+    int selfStatFd = -1;
+
+    std::vector<char> statBuffer; // Grown until it holds every cpu line
+    bool statTruncated = false;   // Reported once
+    CpuTimes prevAggregate;
+    std::vector<CpuTimes> prevCores; // Indexed by CPU number
+    uint64_t cpuSamples = 0;
+    uint64_t prevProcessTicks = 0;
+    double prevSampleSeconds = 0.0;
+    bool havePrevious = false;
+
+    std::vector<TaskFile> tasks;
+    int samplesSinceRescan = 0;
+    bool perThread;
+    long ticksPerSecond;
+    long pageSize;
+};
@@ -0,0 +1,248 @@
+#include "mjpeg_server.hpp"
+#include "stage_metrics.hpp"
+#include "thread_name.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace cv;
+
+static const char* const BOUNDARY = "mjpegframe";
+static const int STALL_TIMEOUT_MS = 10000; // A viewer that takes nothing for this long is dropped
+// Kept small so a slow viewer falls behind by a few frames, not by seconds of
+// kernel-buffered video, before it starts skipping
+static const int SEND_BUFFER_BYTES = 256 * 1024;
+
+static string multipartHeader() {
+    return string("HTTP/1.0 200 OK\r\n"
+                  "Connection: close\r\n"
+                  "Cache-Control: no-cache, no-store\r\n"
+                  "Pragma: no-cache\r\n"
+                  "Content-Type: multipart/x-mixed-replace; boundary=") + BOUNDARY + "\r\n\r\n";
+}
+
+// Stream index for a request path, or -1
+static int streamForPath(const string& path, size_t streams) {
+    if (path == "/" || path == "/stream") return 0;
+    const string prefix = "/stream/";
+    if (path.compare(0, prefix.size(), prefix) != 0 || path.size() == prefix.size()) return -1;
+    char* end = nullptr;
+    long index = strtol(path.c_str() + prefix.size(), &end, 10);
+    if (*end != '\0' || index < 0 || static_cast<size_t>(index) >= streams) return -1;
+    return static_cast<int>(index);
+}
+
+MjpegServer::MjpegServer(const MjpegServerConfig& config, size_t streams)
+    : config(config), streamHeader(make_shared<const string>(multipartHeader())),
+      http(loop, [this](int fd, const string& request) { answerRequest(fd, request); },
+           [this](int fd) { flush(fd); }, [this](int fd) { viewerClosed(fd); }) {
+    for (size_t i = 0; i < streams; i++) channels.push_back(make_unique<Channel>());
+}
+
+MjpegServer::~MjpegServer() {
+    stop();
+    if (frameFd >= 0) close(frameFd);
+}
+
+bool MjpegServer::start() {
+    frameFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (frameFd < 0) {
+        cerr << "HTTP stream setup failed: " << strerror(errno) << endl;
+        return false;
+    }
+
+    if (!loop.start("mjpeg")) return false;
+    HttpListenerConfig listenerConfig;
+    listenerConfig.name = "HTTP stream";
+    listenerConfig.bindAddress = config.bindAddress;
+    listenerConfig.port = config.port;
+    listenerConfig.maxClients = config.maxClients;
+    listenerConfig.sendBufferBytes = SEND_BUFFER_BYTES;
+    listenerConfig.noDelay = true;
+    if (!http.start(listenerConfig)) return false;
+
+    auto framesReady = [this](uint32_t) {
+        uint64_t count;
+        if (read(frameFd, &count, sizeof(count)) > 0) deliverFrames();
+    };
+    if (loop.watch(frameFd, EPOLLIN, framesReady) == 0) {
+        cerr << "HTTP stream setup failed: " << strerror(errno) << endl;
+        return false;
+    }
+
+    encoder = thread(&MjpegServer::encodeLoop, this);
+    return true;
+}
+
+void MjpegServer::stop() {
+    if (encoder.joinable()) {
+        {
+            lock_guard<mutex> lock(framesMutex);
+            stopping = true;
+        }
+        encodeReady.notify_one();
+        encoder.join();
+    }
+    loop.stop();
+}
+
+void MjpegServer::publish(size_t stream, const Mat& frame) {
+    if (stream >= channels.size()) return;
+    Channel& channel = *channels[stream];
+    if (channel.watchers.load(memory_order_relaxed) == 0) return;
+    {
+        // An unencoded older frame is simply replaced; the copy reuses its buffer
+        lock_guard<mutex> lock(framesMutex);
+        frame.copyTo(channel.pending);
+        channel.hasPending = true;
+    }
+    encodeReady.notify_one();
+}
+
+void MjpegServer::encodeLoop() {
+    setCurrentThreadName("mjpeg-enc");
+    const vector<int> params = {IMWRITE_JPEG_QUALITY, config.jpegQuality};
+    Mat frame;
+    vector<uchar> jpeg;
+    char partHeader[128];
+
+    while (true) {
+        size_t stream = 0;
+        {
+            unique_lock<mutex> lock(framesMutex);
+            auto findPending = [&] {
+                for (size_t i = 0; i < channels.size(); i++) {
+                    stream = (nextChannel + i) % channels.size();
+                    if (channels[stream]->hasPending) return true;
+                }
+                return false;
+            };
+            encodeReady.wait(lock, [&] { return stopping || findPending(); });
+            if (stopping) return;
+            // Hand our previous frame's buffer back for the next copy
+            swap(frame, channels[stream]->pending);
+            channels[stream]->hasPending = false;
+            nextChannel = stream + 1;
+        }
+
+        {
+            ScopedStageTimer timer(Stage::StreamEncode);
+            if (!imencode(".jpg", frame, jpeg, params)) continue;
+        }
+        int headerSize = snprintf(partHeader, sizeof(partHeader),
+                                  "--%s\r\nContent-Type: image/jpeg\r\nContent-Length: %zu\r\n\r\n", BOUNDARY,
+                                  jpeg.size());
+        auto part = make_shared<string>();
+        part->reserve(headerSize + jpeg.size() + 2);
+        part->append(partHeader, headerSize);
+        part->append(reinterpret_cast<const char*>(jpeg.data()), jpeg.size());
+        part->append("\r\n");
+        {
+            lock_guard<mutex> lock(framesMutex);
+            channels[stream]->latest = std::move(part);
+            channels[stream]->latestSeq++;
+        }
+        encoded++;
+
+        uint64_t one = 1;
+        if (write(frameFd, &one, sizeof(one)) < 0) {
+            cerr << "HTTP stream frame signal failed: " << strerror(errno) << endl;
+        }
+    }
+}
+
+void MjpegServer::answerRequest(int fd, const string& request) {
+    int stream = -1;
+    if (request.rfind("GET ", 0) == 0) {
+        size_t end = request.find_first_of(" ?\r\n", 4);
+        if (end != string::npos) stream = streamForPath(request.substr(4, end - 4), channels.size());
+    }
+    if (stream < 0) {
+        static const char response[] = "HTTP/1.0 404 Not Found\r\n"
+                                       "Content-Type: text/plain\r\n"
+                                       "Content-Length: 10\r\n"
+                                       "Connection: close\r\n\r\n"
+                                       "Not found\n";
+        send(fd, response, sizeof(response) - 1, MSG_NOSIGNAL);
+        http.close(fd);
+        return;
+    }
+
+    Viewer& viewer = viewers[fd];
+    viewer.stream = static_cast<size_t>(stream);
+    viewer.sending = streamHeader;
+    {
+        // Only parts encoded from now on are sent: the newest one may be from
+        // before anyone was watching
+        lock_guard<mutex> lock(framesMutex);
+        viewer.sentSeq = channels[stream]->latestSeq;
+    }
+    channels[stream]->watchers++;
+    clients++;
+    flush(fd);
+}
+
+// Starts the newest part on every viewer that is not still busy with an older one
+void MjpegServer::deliverFrames() {
+    for (auto it = viewers.begin(); it != viewers.end();) {
+        int fd = it->first;
+        Viewer& viewer = it->second;
+        ++it; // flush() may close the connection
+        if (!viewer.sending && nextFrame(viewer)) flush(fd);
+    }
+}
+
+bool MjpegServer::nextFrame(Viewer& viewer) {
+    lock_guard<mutex> lock(framesMutex);
+    const Channel& channel = *channels[viewer.stream];
+    if (!channel.latest || channel.latestSeq == viewer.sentSeq) return false;
+    skipped += channel.latestSeq - viewer.sentSeq - 1;
+    viewer.sending = channel.latest;
+    viewer.offset = 0;
+    viewer.sentSeq = channel.latestSeq;
+    return true;
+}
+
+// Writes as much as the socket takes without blocking. When a part is done the
+// next is the newest one, whatever came out in between. A viewer is only held
+// to the stall deadline while it has something to take.
+void MjpegServer::flush(int fd) {
+    auto it = viewers.find(fd);
+    if (it == viewers.end()) return;
+    Viewer& viewer = it->second;
+    if (viewer.sending) http.setDeadline(fd, chrono::steady_clock::now() + chrono::milliseconds(STALL_TIMEOUT_MS));
+    while (viewer.sending) {
+        const string& data = *viewer.sending;
+        ssize_t n = send(fd, data.data() + viewer.offset, data.size() - viewer.offset, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                http.wantWrite(fd, true);
+            } else {
+                http.close(fd);
+            }
+            return;
+        }
+        viewer.offset += n;
+        if (viewer.offset == data.size()) {
+            viewer.sending.reset();
+            nextFrame(viewer);
+        }
+    }
+    http.wantWrite(fd, false);
+    http.clearDeadline(fd);
+}
+
+void MjpegServer::viewerClosed(int fd) {
+    auto it = viewers.find(fd);
+    if (it == viewers.end()) return;
+    channels[it->second.stream]->watchers--;
+    clients--;
+    viewers.erase(it);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "event_loop.hpp"
+#include "http_listener.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct MjpegServerConfig {
+    int port = 0;                        // 0 = off
+    std::string bindAddress = "0.0.0.0"; // Every interface: viewers are on other machines
+    int jpegQuality = 70;
+    size_t maxClients = 32;
+};
+
+// Serves each stream's finished HUD frames as multipart/x-mixed-replace MJPEG
+// from its own event loop, apart from the housekeeping one so that pushing
+// video to viewers never delays a probe or a metrics sample:
+// http://<host>:<port>/stream/<n>, with / and /stream for the first stream. A published frame is JPEG-encoded once, on the
+// server's encoder thread and only while someone watches that stream, and the
+// one ref-counted buffer is sent to every client. A client still sending an
+// older frame jumps to the newest one when it is done, so a slow viewer skips
+// frames rather than queueing them.
+class MjpegServer {
+public:
+    MjpegServer(const MjpegServerConfig& config, size_t streams);
+    ~MjpegServer();
+
+    MjpegServer(const MjpegServer&) = delete;
+    MjpegServer& operator=(const MjpegServer&) = delete;
+
+    // Returns false if the address could not be bound or the loop could not be set up
+    bool start();
+    void stop();
+
+    // Called by the render loop with a finished frame. Copies it only if the
+    // stream has viewers, and never waits on encoding or on clients.
+    void publish(size_t stream, const cv::Mat& frame);
+
+    // Safe to read from other threads
+    size_t clientCount() const { return clients; }
+    uint64_t encodedFrames() const { return encoded; }
+    uint64_t skippedFrames() const { return skipped; } // Summed over clients
+
+private:
+    using Buffer = std::shared_ptr<const std::string>;
+
+    // Per stream; everything but watchers is guarded by framesMutex
+    struct Channel {
+        std::atomic<int> watchers{0};
+        cv::Mat pending;       // Newest frame not yet encoded
+        bool hasPending = false;
+        Buffer latest;         // Newest encoded part, boundary and headers included
+        uint64_t latestSeq = 0;
+    };
+
+    // A connection whose request was for a stream
+    struct Viewer {
+        size_t stream = 0;
+        Buffer sending;       // Being written, null when idle
+        size_t offset = 0;
+        uint64_t sentSeq = 0; // Newest frame handed to this viewer
+    };
+
+    void encodeLoop();
+    void answerRequest(int fd, const std::string& request);
+    void deliverFrames();
+    bool nextFrame(Viewer& viewer);
+    void flush(int fd);
+    void viewerClosed(int fd);
+
+    const MjpegServerConfig config;
+    const Buffer streamHeader;
+
+    std::vector<std::unique_ptr<Channel>> channels;
+    std::mutex framesMutex;
+    std::condition_variable encodeReady;
+    bool stopping = false;
+    size_t nextChannel = 0; // Round-robin start for the encoder
+
+    EventLoop loop;
+    HttpListener http;
+    int frameFd = -1; // Encoder -> loop: new parts are ready
+    std::map<int, Viewer> viewers;
+    std::thread encoder;
+
+    std::atomic<size_t> clients{0};
+    std::atomic<uint64_t> encoded{0};
+    std::atomic<uint64_t> skipped{0};
+};
@@ -0,0 +1,79 @@
+#include "motion_gate.hpp"
+#include "stage_metrics.hpp"
+
+using namespace std;
+using namespace cv;
+
+static const Size GATE_SIZE(80, 60);       // 1/8 of the working frame
+static const Size BLOCK_GRID(8, 6);        // 80x80 frame pixels per block
+static const double FULL_SCAN_SHARE = 0.5; // Past this much moving area one full scan is cheaper
+
+MotionGate::MotionGate(const MotionGateConfig& config) : config(config) {}
+
+void MotionGate::update(const Mat& frame, const Mat& luma) {
+    if (!config.enabled) return;
+    ScopedStageTimer timer(Stage::MotionGate);
+    frameSize = frame.size();
+    if (!luma.empty()) {
+        resize(luma, small, GATE_SIZE, 0, 0, INTER_AREA);
+    } else {
+        // Shrinking first leaves the color conversion almost nothing to do
+        resize(frame, smallBgr, GATE_SIZE, 0, 0, INTER_AREA);
+        cvtColor(smallBgr, small, COLOR_BGR2GRAY);
+    }
+    if (!primed) {
+        small.convertTo(background, CV_32F);
+        moving = Mat::zeros(BLOCK_GRID, CV_8U);
+        primed = true;
+        return;
+    }
+
+    background.convertTo(backgroundGray, CV_8U);
+    absdiff(small, backgroundGray, difference);
+    resize(difference, blockScores, BLOCK_GRID, 0, 0, INTER_AREA); // Mean per block
+    threshold(blockScores, moving, config.threshold, 255, THRESH_BINARY);
+    changedFraction = static_cast<float>(countNonZero(moving)) / BLOCK_GRID.area();
+    dilate(moving, moving, Mat()); // A face straddling a block edge needs its neighbour too
+    accumulateWeighted(small, background, config.learningRate);
+}
+
+MotionGate::Sweep MotionGate::planSweep(chrono::steady_clock::time_point now, vector<Rect>& regions) {
+    regions.clear();
+    auto fullScanInterval = chrono::duration<double>(config.fullScanSeconds);
+    int moved = primed ? countNonZero(moving) : 0;
+    if (!config.enabled || !primed || !scannedOnce || now - lastFullScan >= fullScanInterval
+        || moved > BLOCK_GRID.area() * FULL_SCAN_SHARE) {
+        scannedOnce = true;
+        lastFullScan = now;
+        fullScans++;
+        return Sweep::Full;
+    }
+    if (moved == 0) {
+        skipped++;
+        return Sweep::Skip;
+    }
+
+    // One region per connected patch of moving blocks
+    int count = connectedComponentsWithStats(moving, labels, components, centroids, 8);
+    double blockWidth = static_cast<double>(frameSize.width) / BLOCK_GRID.width;
+    double blockHeight = static_cast<double>(frameSize.height) / BLOCK_GRID.height;
+    for (int i = 1; i < count; i++) {
+        const int* box = components.ptr<int>(i);
+        int x0 = static_cast<int>(box[CC_STAT_LEFT] * blockWidth);
+        int y0 = static_cast<int>(box[CC_STAT_TOP] * blockHeight);
+        int x1 = static_cast<int>((box[CC_STAT_LEFT] + box[CC_STAT_WIDTH]) * blockWidth);
+        int y1 = static_cast<int>((box[CC_STAT_TOP] + box[CC_STAT_HEIGHT]) * blockHeight);
+        regions.emplace_back(x0, y0, x1 - x0, y1 - y0);
+    }
+    partialScans++;
+    return Sweep::Changed;
+}
+
+MotionGate::Stats MotionGate::stats() const {
+    Stats stats;
+    stats.fullScans = fullScans;
+    stats.partialScans = partialScans;
+    stats.skipped = skipped;
+    stats.changedFraction = changedFraction;
+    return stats;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+struct MotionGateConfig {
+    bool enabled = true;
+    double threshold = 6.0;       // Mean gray-level change that marks a block as moving
+    double fullScanSeconds = 2.0; // Longest time without a full-frame scan
+    double learningRate = 0.05;   // Background update weight per detection pass
+};
+
+// Decides whether a detection pass that would scan the whole frame needs to.
+// Each pass's frame is shrunk to a small gray image and compared against a
+// running-average background, block by block. Passes on a static scene are
+// skipped, passes with motion only scan the blocks that changed (plus a block
+// of margin), and a full scan still runs every fullScanSeconds so a face that
+// holds still is found anyway.
+class MotionGate {
+public:
+    enum class Sweep {
+        Full,    // Scan the whole frame
+        Changed, // Scan only the regions returned
+        Skip     // Nothing moved: no detection this pass
+    };
+
+    // Counters for the HUD; safe to read from other threads
+    struct Stats {
+        uint64_t fullScans = 0;
+        uint64_t partialScans = 0;
+        uint64_t skipped = 0;
+        float changedFraction = 0.0f; // Of the blocks, on the latest pass
+    };
+
+    explicit MotionGate(const MotionGateConfig& config);
+
+    // Folds a detection pass's frame into the background model. luma, if not
+    // empty, is the frame's own gray plane.
+    void update(const cv::Mat& frame, const cv::Mat& luma);
+
+    // Called when the tracker asks for a full sweep. Fills regions, in frame
+    // pixels, when the answer is Changed.
+    Sweep planSweep(std::chrono::steady_clock::time_point now, std::vector<cv::Rect>& regions);
+
+    Stats stats() const;
+
+private:
+    MotionGateConfig config;
+    cv::Size frameSize;
+    cv::Mat small;      // Shrunk gray frame
+    cv::Mat smallBgr;
+    cv::Mat background; // 32F running average of small
+    cv::Mat backgroundGray;
+    cv::Mat difference;
+    cv::Mat blockScores; // Mean change per block
+    cv::Mat moving;      // 8U block mask, dilated by one block
+    cv::Mat labels, components, centroids;
+    bool primed = false;
+    bool scannedOnce = false;
+    std::chrono::steady_clock::time_point lastFullScan;
+
+    std::atomic<uint64_t> fullScans{0};
+    std::atomic<uint64_t> partialScans{0};
+    std::atomic<uint64_t> skipped{0};
+    std::atomic<float> changedFraction{0.0f};
+};
@@ -0,0 +1,124 @@
+#include "multi_tracker.hpp"
+#include "face_tracker.hpp"
+
+#include <algorithm>
+
+using namespace std;
+using namespace cv;
+
+// Association and filter tuning
+static const float MIN_MATCH_IOU = 0.3f;
+static const double MAX_MATCH_DISTANCE = 100.0; // Centre distance fallback, pixels
+static const float POSITION_GAIN = 0.7f;        // Alpha: how far to move toward a measurement
+static const float VELOCITY_GAIN = 0.3f;        // Beta: how much of the residual feeds velocity
+static const float ROI_SCALE = 2.0f;            // Search region size relative to the face
+static const int TRACK_TIMEOUT_MS = 1000;       // Drop tracks not seen for this long
+
+static float iou(const Rect2f& a, const Rect2f& b) {
+    float inter = (a & b).area();
+    float uni = a.area() + b.area() - inter;
+    return uni > 0 ? inter / uni : 0.0f;
+}
+
+Rect FaceTrack::predict(uint64_t atSeq) const {
+    float frames = static_cast<float>(static_cast<int64_t>(atSeq - seq));
+    return Rect(Rect2f(box.x + velocity.x * frames, box.y + velocity.y * frames, box.width, box.height));
+}
+
+MultiFaceTracker::MultiFaceTracker(int fullSweepInterval)
+    : fullSweepInterval(max(1, fullSweepInterval)),
+      passesSinceSweep(fullSweepInterval) {} // First pass is always a full sweep
+
+vector<Rect> MultiFaceTracker::searchRegions(const Size& frameSize, uint64_t seq) {
+    vector<Rect> regions;
+    if (activeTracks.empty() || passesSinceSweep + 1 >= fullSweepInterval) {
+        passesSinceSweep = 0;
+        return regions;
+    }
+    passesSinceSweep++;
+
+    regions = trackRegions(frameSize, seq);
+    // A track that drifted fully off-frame leaves nothing to scan
+    if (regions.empty()) passesSinceSweep = 0;
+    return regions;
+}
+
+vector<Rect> MultiFaceTracker::trackRegions(const Size& frameSize, uint64_t seq) const {
+    vector<Rect> regions;
+    Rect frameRect(Point(0, 0), frameSize);
+    for (const auto& track : activeTracks) {
+        Rect predicted = track.predict(seq);
+        int padX = static_cast<int>(predicted.width * (ROI_SCALE - 1.0f) / 2);
+        int padY = static_cast<int>(predicted.height * (ROI_SCALE - 1.0f) / 2);
+        Rect region = Rect(predicted.x - padX, predicted.y - padY,
+                           predicted.width + 2 * padX, predicted.height + 2 * padY) & frameRect;
+        if (!region.empty()) regions.push_back(region);
+    }
+    return regions;
+}
+
+void MultiFaceTracker::update(const vector<Rect>& detections, uint64_t seq,
+                              chrono::steady_clock::time_point now) {
+    // Greedy association: best-overlapping pairs first
+    struct Candidate { float score; size_t track; size_t detection; };
+    vector<Candidate> candidates;
+    for (size_t t = 0; t < activeTracks.size(); t++) {
+        Rect2f predicted = activeTracks[t].predict(seq);
+        for (size_t d = 0; d < detections.size(); d++) {
+            float overlap = iou(predicted, Rect2f(detections[d]));
+            if (overlap >= MIN_MATCH_IOU) {
+                candidates.push_back({1.0f + overlap, t, d});
+            } else {
+                // Small or fast faces can jump clear of their own box between passes
+                double distance = calculateRectDistance(predicted, detections[d]);
+                if (distance <= MAX_MATCH_DISTANCE) {
+                    candidates.push_back({static_cast<float>(1.0 - distance / MAX_MATCH_DISTANCE), t, d});
+                }
+            }
+        }
+    }
+    sort(candidates.begin(), candidates.end(),
+         [](const Candidate& a, const Candidate& b) { return a.score > b.score; });
+
+    vector<bool> trackMatched(activeTracks.size(), false);
+    vector<bool> detectionMatched(detections.size(), false);
+    for (const auto& c : candidates) {
+        if (trackMatched[c.track] || detectionMatched[c.detection]) continue;
+        trackMatched[c.track] = true;
+        detectionMatched[c.detection] = true;
+
+        FaceTrack& track = activeTracks[c.track];
+        float frames = max(1.0f, static_cast<float>(static_cast<int64_t>(seq - track.seq)));
+        Rect2f predicted = track.predict(seq);
+        Rect2f measured(detections[c.detection]);
+
+        Point2f residual((measured.x + measured.width / 2) - (predicted.x + predicted.width / 2),
+                         (measured.y + measured.height / 2) - (predicted.y + predicted.height / 2));
+        float width = predicted.width + POSITION_GAIN * (measured.width - predicted.width);
+        float height = predicted.height + POSITION_GAIN * (measured.height - predicted.height);
+        float cx = predicted.x + predicted.width / 2 + POSITION_GAIN * residual.x;
+        float cy = predicted.y + predicted.height / 2 + POSITION_GAIN * residual.y;
+
+        track.box = Rect2f(cx - width / 2, cy - height / 2, width, height);
+        track.velocity += residual * (VELOCITY_GAIN / frames);
+        track.seq = seq;
+        track.lastSeen = now;
+    }
+
+    // Tracks that went unseen coast on their velocity until they time out
+    auto timeout = chrono::milliseconds(TRACK_TIMEOUT_MS);
+    activeTracks.erase(remove_if(activeTracks.begin(), activeTracks.end(),
+                                 [&](const FaceTrack& track) { return now - track.lastSeen > timeout; }),
+                       activeTracks.end());
+
+    for (size_t d = 0; d < detections.size(); d++) {
+        if (detectionMatched[d]) continue;
+        FaceTrack track;
+        track.id = nextId++;
+        track.box = Rect2f(detections[d]);
+        track.seq = seq;
+        track.firstSeen = now;
+        track.lastSeen = now;
+        activeTracks.push_back(track);
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// One face followed across detection passes
+struct FaceTrack {
+    int id = 0;
+    cv::Rect2f box;      // Smoothed box as of frame `seq`
+    cv::Point2f velocity; // Pixels per frame
+    uint64_t seq = 0;
+    std::chrono::steady_clock::time_point firstSeen;
+    std::chrono::steady_clock::time_point lastSeen;
+
+    // Box extrapolated to another frame of the same stream
+    cv::Rect predict(uint64_t atSeq) const;
+};
+
+// Assigns stable IDs to faces and decides where the next detection pass has to
+// look. Tracks are matched by IoU (falling back to centre distance) and
+// smoothed with a constant-velocity alpha-beta filter, the steady-state form
+// of a Kalman filter.
+class MultiFaceTracker {
+public:
+    // fullSweepInterval: every Nth pass scans the whole frame for new faces;
+    // the others only scan enlarged regions around the existing tracks
+    explicit MultiFaceTracker(int fullSweepInterval);
+
+    // Regions to scan on frame `seq`. Empty means scan the whole frame.
+    std::vector<cv::Rect> searchRegions(const cv::Size& frameSize, uint64_t seq);
+    // The enlarged regions around the tracks, whatever pass this is
+    std::vector<cv::Rect> trackRegions(const cv::Size& frameSize, uint64_t seq) const;
+
+    // Folds one pass worth of detections from frame `seq` into the tracks
+    void update(const std::vector<cv::Rect>& detections, uint64_t seq,
+                std::chrono::steady_clock::time_point now);
+
+    const std::vector<FaceTrack>& tracks() const { return activeTracks; }
+
+private:
+    int fullSweepInterval;
+    int passesSinceSweep = 0;
+    int nextId = 1;
+    std::vector<FaceTrack> activeTracks;
+};
@@ -0,0 +1,298 @@
+#include "net_probe.hpp"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/ip_icmp.h>
+#include <netinet/icmp6.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const size_t NETLINK_BUFFER_SIZE = 16384;
+static const size_t ICMP_BUFFER_SIZE = 256;
+
+bool parseProbeTarget(const string& spec, ProbeTarget& target) {
+    string host, port;
+    target = ProbeTarget();
+    target.label = spec;
+
+    if (spec.rfind("icmp:", 0) == 0) {
+        target.kind = ProbeKind::Icmp;
+        host = spec.substr(5);
+    } else {
+        size_t colon = spec.rfind(':');
+        if (colon == string::npos || colon + 1 == spec.size()) return false;
+        host = spec.substr(0, colon);
+        port = spec.substr(colon + 1);
+    }
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+    if (host.empty()) return false;
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = target.kind == ProbeKind::Tcp ? SOCK_STREAM : SOCK_DGRAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), port.empty() ? nullptr : port.c_str(), &hints, &result) != 0 || !result) {
+        return false;
+    }
+    memcpy(&target.addr, result->ai_addr, result->ai_addrlen);
+    target.addrLen = result->ai_addrlen;
+    freeaddrinfo(result);
+    return true;
+}
+
+NetProbe::NetProbe(EventLoop& loop, vector<ProbeTarget> targets, int intervalMs, int timeoutMs,
+                   UpdateCallback onUpdate)
+    : targets(std::move(targets)), probes(this->targets.size()), intervalMs(max(1, intervalMs)),
+      timeoutMs(min(timeoutMs, this->intervalMs)), onUpdate(std::move(onUpdate)), loop(loop) {}
+
+NetProbe::~NetProbe() {
+    loop.cancel(roundTask);
+    loop.cancel(timeoutTask);
+    for (auto& probe : probes) {
+        loop.unwatch(probe.watch);
+        if (probe.fd >= 0) close(probe.fd);
+    }
+    loop.unwatch(netlinkWatch);
+    if (netlinkFd >= 0) close(netlinkFd);
+}
+
+void NetProbe::start() {
+    // Link state is a bonus; without netlink the probes still run on the timer
+    netlinkFd = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (netlinkFd >= 0) {
+        sockaddr_nl local = {};
+        local.nl_family = AF_NETLINK;
+        local.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+        if (bind(netlinkFd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) == 0) {
+            netlinkWatch = loop.watch(netlinkFd, EPOLLIN, [this](uint32_t) { handleNetlink(); });
+        }
+        if (netlinkWatch != 0) {
+            requestLinkDump();
+        } else {
+            close(netlinkFd);
+            netlinkFd = -1;
+        }
+    }
+
+    // First round right away, then every interval
+    roundTask = loop.schedulePeriodic(chrono::milliseconds(intervalMs), [this] { startRound(); });
+}
+
+NetStatus NetProbe::status() const {
+    lock_guard<mutex> lock(mtx);
+    return current;
+}
+
+void NetProbe::startRound() {
+    // A round still in flight is abandoned without being published
+    pending = 0;
+    for (size_t i = 0; i < probes.size(); i++) {
+        if (probes[i].fd >= 0) finishProbe(i, false);
+    }
+    pending = probes.size();
+    for (size_t i = 0; i < probes.size(); i++) {
+        beginProbe(i);
+    }
+
+    // Every probe of the round shares one deadline
+    loop.cancel(timeoutTask);
+    if (pending > 0) timeoutTask = loop.scheduleOnce(chrono::milliseconds(timeoutMs), [this] { expireProbes(); });
+}
+
+void NetProbe::beginProbe(size_t index) {
+    const ProbeTarget& target = targets[index];
+    Probe& probe = probes[index];
+    probe.rttMs = -1.0;
+    probe.started = chrono::steady_clock::now();
+
+    int family = target.addr.ss_family;
+    const sockaddr* addr = reinterpret_cast<const sockaddr*>(&target.addr);
+
+    if (target.kind == ProbeKind::Tcp) {
+        probe.fd = socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (probe.fd < 0) {
+            finishProbe(index, false);
+            return;
+        }
+        if (connect(probe.fd, addr, target.addrLen) == 0 || errno == ECONNREFUSED) {
+            finishProbe(index, true); // Loopback completes immediately
+            return;
+        }
+        if (errno != EINPROGRESS) {
+            finishProbe(index, false);
+            return;
+        }
+        probe.watch = loop.watch(probe.fd, EPOLLOUT,
+                                 [this, index](uint32_t events) { handleProbeEvent(index, events); });
+        if (probe.watch == 0) finishProbe(index, false);
+        return;
+    }
+
+    // The kernel fills in the echo identifier and checksum for ping sockets
+    int protocol = family == AF_INET6 ? static_cast<int>(IPPROTO_ICMPV6) : static_cast<int>(IPPROTO_ICMP);
+    probe.fd = socket(family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, protocol);
+    if (probe.fd < 0) {
+        if (!probe.warned) {
+            cerr << "Cannot open ICMP socket for " << target.label
+                 << " (check net.ipv4.ping_group_range); it will report down" << endl;
+            probe.warned = true;
+        }
+        finishProbe(index, false);
+        return;
+    }
+    probe.seq = ++nextSeq;
+    unsigned char packet[16] = {};
+    packet[0] = family == AF_INET6 ? ICMP6_ECHO_REQUEST : ICMP_ECHO;
+    uint16_t seq = htons(probe.seq);
+    memcpy(packet + 6, &seq, sizeof(seq));
+    if (sendto(probe.fd, packet, sizeof(packet), 0, addr, target.addrLen) < 0) {
+        finishProbe(index, false);
+        return;
+    }
+    probe.watch = loop.watch(probe.fd, EPOLLIN,
+                             [this, index](uint32_t events) { handleProbeEvent(index, events); });
+    if (probe.watch == 0) finishProbe(index, false);
+}
+
+void NetProbe::handleProbeEvent(size_t index, uint32_t events) {
+    Probe& probe = probes[index];
+    if (probe.fd < 0) return;
+
+    if (targets[index].kind == ProbeKind::Tcp) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(probe.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        finishProbe(index, error == 0 || error == ECONNREFUSED);
+        return;
+    }
+
+    if (events & EPOLLERR) {
+        finishProbe(index, false);
+        return;
+    }
+    unsigned char reply[ICMP_BUFFER_SIZE];
+    ssize_t n;
+    bool v6 = targets[index].addr.ss_family == AF_INET6;
+    while ((n = recv(probe.fd, reply, sizeof(reply), 0)) >= 8) {
+        uint16_t seq;
+        memcpy(&seq, reply + 6, sizeof(seq));
+        bool isReply = v6 ? reply[0] == ICMP6_ECHO_REPLY : reply[0] == ICMP_ECHOREPLY;
+        if (isReply && ntohs(seq) == probe.seq) {
+            finishProbe(index, true);
+            return;
+        }
+    }
+}
+
+void NetProbe::finishProbe(size_t index, bool reachable) {
+    Probe& probe = probes[index];
+    if (probe.fd >= 0) {
+        loop.unwatch(probe.watch);
+        probe.watch = 0;
+        close(probe.fd);
+        probe.fd = -1;
+    }
+    if (reachable) {
+        probe.rttMs = chrono::duration<double, milli>(chrono::steady_clock::now() - probe.started).count();
+    }
+    if (pending > 0 && --pending == 0) publish();
+}
+
+void NetProbe::expireProbes() {
+    for (size_t i = 0; i < probes.size(); i++) {
+        if (probes[i].fd >= 0) finishProbe(i, false);
+    }
+}
+
+void NetProbe::requestLinkDump() {
+    struct {
+        nlmsghdr header;
+        ifinfomsg info;
+    } request = {};
+    request.header.nlmsg_len = sizeof(request);
+    request.header.nlmsg_type = RTM_GETLINK;
+    request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.info.ifi_family = AF_UNSPEC;
+
+    sockaddr_nl kernel = {};
+    kernel.nl_family = AF_NETLINK;
+    sendto(netlinkFd, &request, sizeof(request), 0, reinterpret_cast<sockaddr*>(&kernel), sizeof(kernel));
+}
+
+void NetProbe::handleNetlink() {
+    alignas(nlmsghdr) char buffer[NETLINK_BUFFER_SIZE];
+    bool changed = false;
+    ssize_t n;
+
+    while ((n = recv(netlinkFd, buffer, sizeof(buffer), 0)) > 0) {
+        int length = static_cast<int>(n);
+        for (nlmsghdr* msg = reinterpret_cast<nlmsghdr*>(buffer); NLMSG_OK(msg, length);
+             msg = NLMSG_NEXT(msg, length)) {
+            if (msg->nlmsg_type == RTM_NEWADDR || msg->nlmsg_type == RTM_DELADDR) {
+                changed = true; // Addresses moved; routes may have too
+                continue;
+            }
+            if (msg->nlmsg_type != RTM_NEWLINK && msg->nlmsg_type != RTM_DELLINK) continue;
+
+            const ifinfomsg* info = static_cast<const ifinfomsg*>(NLMSG_DATA(msg));
+            if (info->ifi_flags & IFF_LOOPBACK) continue;
+            bool running = msg->nlmsg_type == RTM_NEWLINK && (info->ifi_flags & IFF_RUNNING);
+
+            auto it = find_if(links.begin(), links.end(),
+                              [info](const LinkState& link) { return link.index == info->ifi_index; });
+            if (it == links.end()) {
+                links.push_back({info->ifi_index, running});
+                changed = true;
+            } else if (it->running != running) {
+                it->running = running;
+                changed = true;
+            }
+        }
+    }
+    if (!changed) return;
+
+    // With no interfaces besides loopback there is nothing to judge by, so
+    // leave it to the probes
+    bool linkUp = links.empty() || any_of(links.begin(), links.end(),
+                                          [](const LinkState& link) { return link.running; });
+    bool wasUp;
+    {
+        lock_guard<mutex> lock(mtx);
+        wasUp = current.linkUp;
+        current.linkUp = linkUp;
+        if (!linkUp) current.connected = false;
+    }
+    if (wasUp != linkUp && onUpdate) onUpdate(status());
+    startRound();
+}
+
+void NetProbe::publish() {
+    NetStatus next;
+    for (size_t i = 0; i < probes.size(); i++) {
+        double rtt = probes[i].rttMs;
+        if (rtt >= 0 && (!next.connected || rtt < next.rttMs)) {
+            next.connected = true;
+            next.rttMs = rtt;
+            next.via = targets[i].label;
+        }
+    }
+    {
+        lock_guard<mutex> lock(mtx);
+        next.linkUp = current.linkUp;
+        if (!next.linkUp) next.connected = false;
+        current = next;
+    }
+    if (onUpdate) onUpdate(next);
+}
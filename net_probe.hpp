@@ -0,0 +1,99 @@
+#pragma once
+
+#include "event_loop.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <sys/socket.h>
+#include <vector>
+
+enum class ProbeKind {
+    Tcp, // Non-blocking connect; an accept or a refusal both prove the path works
+    Icmp // Echo over an unprivileged ICMP datagram socket
+};
+
+struct ProbeTarget {
+    ProbeKind kind = ProbeKind::Tcp;
+    sockaddr_storage addr = {};
+    socklen_t addrLen = 0;
+    std::string label; // The spec it was parsed from
+};
+
+// Parses "host:port" (TCP), "[v6addr]:port" or "icmp:host". Numeric addresses
+// are used as-is; names are looked up once, here, never while probing.
+bool parseProbeTarget(const std::string& spec, ProbeTarget& target);
+
+struct NetStatus {
+    bool connected = false;
+    bool linkUp = true;  // False once every non-loopback interface is down
+    double rttMs = 0.0;  // Fastest reachable target in the last round
+    std::string via;     // Label of that target
+};
+
+// Connectivity prober driven by the shared event loop. Every interval it
+// probes all targets concurrently; the network counts as connected if any
+// answers within the timeout. Netlink link and address notifications trigger an
+// immediate re-probe, and a link going down is reported at once. Never forks.
+class NetProbe {
+public:
+    using UpdateCallback = std::function<void(const NetStatus&)>;
+
+    // onUpdate runs on the loop thread after every round and link change
+    NetProbe(EventLoop& loop, std::vector<ProbeTarget> targets, int intervalMs, int timeoutMs,
+             UpdateCallback onUpdate);
+    // The loop must have stopped first
+    ~NetProbe();
+
+    NetProbe(const NetProbe&) = delete;
+    NetProbe& operator=(const NetProbe&) = delete;
+
+    // Registers with the (started) loop; the first round runs right away
+    void start();
+
+    NetStatus status() const;
+
+private:
+    struct Probe {
+        int fd = -1;
+        EventLoop::WatchId watch = 0;
+        uint16_t seq = 0;
+        std::chrono::steady_clock::time_point started;
+        double rttMs = -1.0; // -1 while pending or after a failure
+        bool warned = false;
+    };
+
+    struct LinkState {
+        int index;
+        bool running;
+    };
+
+    void startRound();
+    void beginProbe(size_t index);
+    void finishProbe(size_t index, bool reachable);
+    void handleProbeEvent(size_t index, uint32_t events);
+    void expireProbes();
+    void requestLinkDump();
+    void handleNetlink();
+    void publish();
+
+    std::vector<ProbeTarget> targets;
+    std::vector<Probe> probes;
+    std::vector<LinkState> links;
+    size_t pending = 0;
+    uint16_t nextSeq = 0;
+    const int intervalMs;
+    const int timeoutMs;
+    UpdateCallback onUpdate;
+
+    EventLoop& loop;
+    EventLoop::TaskId roundTask = 0;
+    EventLoop::TaskId timeoutTask = 0;
+    int netlinkFd = -1;
+    EventLoop::WatchId netlinkWatch = 0;
+
+    mutable std::mutex mtx;
+    NetStatus current;
+};
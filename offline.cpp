@@ -0,0 +1,177 @@
+#include "offline.hpp"
+#include "face_detector.hpp"
+#include "face_tracker.hpp"
+#include "frame_pool.hpp"
+#include "frame_source.hpp"
+#include "multi_tracker.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+using namespace cv;
+namespace fs = std::filesystem;
+
+struct InputReport {
+    string path;
+    string name;
+    bool ok = false;
+    uint64_t frames = 0;
+    int snapshots = 0;
+    int duplicates = 0;
+    double seconds = 0.0;
+};
+
+static void processInput(FaceDetector& detector, SnapshotWriter& writer,
+                         const OfflineConfig& config, InputReport& report) {
+    auto start = chrono::steady_clock::now();
+
+    auto source = openInputSource(report.path);
+    if (!source) return;
+
+    string snapshotDir = "snapshot/" + report.name;
+    error_code ec;
+    fs::create_directories(snapshotDir, ec);
+    if (ec) {
+        cerr << "Failed to create " << snapshotDir << ": " << ec.message() << endl;
+        return;
+    }
+
+    // Cooldowns and detection windows run on media time, so results do not
+    // depend on how fast this machine gets through the file
+    FaceTracker tracker(snapshotDir, SnapshotNaming::FrameIndex, false, writer, config.dedup);
+    MultiFaceTracker tracks(config.fullSweepInterval);
+    auto frameInterval = chrono::duration_cast<chrono::steady_clock::duration>(
+        chrono::duration<double>(1.0 / source->fps()));
+    chrono::steady_clock::time_point mediaStart;
+
+    Mat frame, resizedFrame, gray;
+    attachFramePool(frame);
+    attachFramePool(resizedFrame);
+    LumaPlane luma;
+    uint64_t seq = 0;
+
+    while (source->readWithLuma(frame, luma)) {
+        // Skip the resize entirely when the input is already the working size;
+        // native luma is only usable at that size
+        const Mat* working = &frame;
+        if (frame.size() != Size(640, 480)) {
+            resize(frame, resizedFrame, Size(640, 480));
+            working = &resizedFrame;
+            luma = LumaPlane();
+        }
+        if (seq % config.detection.interval == 0) {
+            auto mediaTime = mediaStart + frameInterval * static_cast<int64_t>(seq);
+            detectTrackedFaces(detector, tracks, *working, luma.gray, gray, seq, mediaTime, config.detection);
+            if (tracker.update(tracks.tracks(), *working, mediaTime, seq)) {
+                // The writer now shares these buffers; the next read takes recycled ones
+                frame.release();
+                resizedFrame.release();
+            }
+        }
+        seq++;
+    }
+
+    report.ok = true;
+    report.frames = seq;
+    report.snapshots = tracker.snapshotCount();
+    report.duplicates = tracker.duplicateCount();
+    report.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+static void worker(vector<InputReport>& reports, atomic<size_t>& nextInput, SnapshotWriter& writer,
+                   const OfflineConfig& config, int detectThreads) {
+    // Detectors are not safe to share, so every worker loads its own
+    auto detector = createFaceDetector(config.detector, detectThreads);
+    if (!detector) return;
+
+    size_t index;
+    while ((index = nextInput.fetch_add(1)) < reports.size()) {
+        processInput(*detector, writer, config, reports[index]);
+    }
+}
+
+static void printReport(const vector<InputReport>& reports, const SnapshotWriter& writer,
+                        double wallSeconds, size_t jobs) {
+    cout << endl << left << setw(24) << "INPUT" << right << setw(10) << "FRAMES"
+         << setw(11) << "SNAPSHOTS" << setw(8) << "DUPES" << setw(10) << "SECONDS" << setw(10) << "FPS" << endl;
+
+    uint64_t totalFrames = 0;
+    int totalSnapshots = 0;
+    int totalDuplicates = 0;
+    for (const auto& report : reports) {
+        cout << left << setw(24) << report.name << right;
+        if (!report.ok) {
+            cout << setw(10) << "FAILED" << endl;
+            continue;
+        }
+        double fps = report.seconds > 0 ? report.frames / report.seconds : 0.0;
+        cout << setw(10) << report.frames << setw(11) << report.snapshots << setw(8) << report.duplicates
+             << fixed << setprecision(2) << setw(10) << report.seconds
+             << setprecision(1) << setw(10) << fps << endl;
+        totalFrames += report.frames;
+        totalSnapshots += report.snapshots;
+        totalDuplicates += report.duplicates;
+    }
+
+    double aggregateFps = wallSeconds > 0 ? totalFrames / wallSeconds : 0.0;
+    cout << left << setw(24) << ("TOTAL (" + to_string(jobs) + " workers)") << right
+         << setw(10) << totalFrames << setw(11) << totalSnapshots << setw(8) << totalDuplicates
+         << fixed << setprecision(2) << setw(10) << wallSeconds
+         << setprecision(1) << setw(10) << aggregateFps << endl;
+
+    cout << "Snapshots written: " << writer.writtenCount() << ", failed: " << writer.failedCount()
+         << ", dropped: " << writer.droppedCount() << endl;
+}
+
+int runOffline(const OfflineConfig& config) {
+    if (config.inputs.empty()) {
+        cerr << "No offline inputs given" << endl;
+        return -1;
+    }
+
+    // Give every input its own snapshot directory, even if two share a name
+    vector<string> names;
+    for (const auto& input : config.inputs) names.push_back(inputSourceName(input));
+    names = uniqueSourceNames(names);
+
+    vector<InputReport> reports(config.inputs.size());
+    for (size_t i = 0; i < config.inputs.size(); i++) {
+        reports[i].path = config.inputs[i];
+        reports[i].name = names[i];
+    }
+
+    size_t cores = max(1u, thread::hardware_concurrency());
+    size_t jobs = config.jobs > 0 ? config.jobs : cores;
+    jobs = min(jobs, reports.size());
+
+    // With a stream on every core, OpenCV's own worker threads only add contention
+    if (jobs >= cores) setNumThreads(1);
+
+    // Cores not taken by a stream go to splitting each stream's pyramid
+    int detectThreads = config.detectThreads > 0 ? config.detectThreads
+                                                 : static_cast<int>(max<size_t>(1, cores / jobs));
+
+    auto start = chrono::steady_clock::now();
+    SnapshotWriter writer(config.snapshots);
+    atomic<size_t> nextInput{0};
+    vector<thread> workers;
+    for (size_t i = 0; i < jobs; i++) {
+        workers.emplace_back(worker, ref(reports), ref(nextInput), ref(writer), cref(config), detectThreads);
+    }
+    for (auto& t : workers) t.join();
+    writer.drain();
+    double wallSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    printReport(reports, writer, wallSeconds, jobs);
+
+    bool allOk = all_of(reports.begin(), reports.end(), [](const InputReport& r) { return r.ok; })
+                 && writer.failedCount() == 0;
+    return allOk ? 0 : 1;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "face_detector.hpp"
+#include "face_tracker.hpp"
+#include "snapshot_writer.hpp"
+
+#include <string>
+#include <vector>
+
+struct OfflineConfig {
+    std::vector<std::string> inputs; // Video files or image directories
+    int jobs = 0;                    // Worker threads, 0 = one per core
+    int detectThreads = 0;           // Pyramid threads per worker, 0 = share out the spare cores
+    DetectorConfig detector;
+    DetectionParams detection;
+    int fullSweepInterval = 5;
+    SnapshotDedupConfig dedup;
+    SnapshotWriterConfig snapshots{1, 4, SnapshotDropPolicy::Block}; // Never lose offline results
+};
+
+// Runs face detection and snapshotting over recorded inputs with no window and
+// no frame pacing. Snapshots go to snapshot/<input name>/. Returns non-zero if
+// any input could not be processed.
+int runOffline(const OfflineConfig& config);
@@ -0,0 +1,208 @@
+#include "snapshot_index.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace cv;
+
+static const char INDEX_MAGIC[8] = {'C', 'Y', 'B', 'S', 'N', 'A', 'P', '\0'};
+static const uint32_t INDEX_VERSION = 1;
+
+struct IndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t clock; // SnapshotClock
+    uint32_t reserved;
+};
+static_assert(sizeof(IndexHeader) % alignof(SnapshotRecord) == 0, "records must stay aligned when mapped");
+
+uint64_t differenceHash(const Mat& image, const Rect& box) {
+    Mat region = box.area() > 0 ? image(box & Rect(0, 0, image.cols, image.rows)) : image;
+    if (region.empty()) return 0;
+
+    // Shrink first, so only 72 pixels go through the colour conversion
+    Mat small, gray;
+    resize(region, small, Size(9, 8), 0, 0, INTER_AREA);
+    if (small.channels() == 3) {
+        cvtColor(small, gray, COLOR_BGR2GRAY);
+    } else {
+        gray = small;
+    }
+
+    uint64_t hash = 0;
+    for (int y = 0; y < 8; y++) {
+        const uchar* row = gray.ptr<uchar>(y);
+        for (int x = 0; x < 8; x++) {
+            hash = (hash << 1) | (row[x] < row[x + 1] ? 1 : 0);
+        }
+    }
+    return hash;
+}
+
+bool RecentHashes::contains(uint64_t hash, int64_t nowUs, int maxDistance, int64_t windowUs) const {
+    for (size_t i = 0; i < count; i++) {
+        if (nowUs - entries[i].timeUs <= windowUs && hashDistance(hash, entries[i].hash) <= maxDistance) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void RecentHashes::add(uint64_t hash, int64_t timeUs) {
+    entries[next] = Entry{hash, timeUs};
+    next = (next + 1) % CAPACITY;
+    if (count < CAPACITY) count++;
+}
+
+static bool writeFully(int fd, const void* data, size_t length) {
+    const char* p = static_cast<const char*>(data);
+    while (length > 0) {
+        ssize_t n = write(fd, p, length);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        length -= n;
+    }
+    return true;
+}
+
+shared_ptr<SnapshotIndex> SnapshotIndex::open(const string& dir, SnapshotClock clock) {
+    string recordsPath = dir + "/" + SNAPSHOT_INDEX_FILE;
+    string namesPath = dir + "/" + SNAPSHOT_NAMES_FILE;
+    int flags = O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC | (clock == SnapshotClock::Media ? O_TRUNC : 0);
+    int recordsFd = ::open(recordsPath.c_str(), flags, 0644);
+    if (recordsFd < 0) {
+        cerr << "Cannot open snapshot index " << recordsPath << ": " << strerror(errno) << endl;
+        return nullptr;
+    }
+    int namesFd = ::open(namesPath.c_str(), flags, 0644);
+    if (namesFd < 0) {
+        cerr << "Cannot open snapshot index " << namesPath << ": " << strerror(errno) << endl;
+        ::close(recordsFd);
+        return nullptr;
+    }
+    auto fail = [&](const string& why) -> shared_ptr<SnapshotIndex> {
+        cerr << "Snapshot index " << recordsPath << ": " << why << endl;
+        ::close(recordsFd);
+        ::close(namesFd);
+        return nullptr;
+    };
+
+    struct stat st;
+    if (fstat(recordsFd, &st) < 0) return fail(strerror(errno));
+    size_t size = static_cast<size_t>(st.st_size);
+    if (size == 0) {
+        IndexHeader header = {};
+        memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+        header.version = INDEX_VERSION;
+        header.recordSize = sizeof(SnapshotRecord);
+        header.clock = static_cast<uint32_t>(clock);
+        if (!writeFully(recordsFd, &header, sizeof(header))) return fail(strerror(errno));
+    } else {
+        IndexHeader header;
+        if (size < sizeof(header) || pread(recordsFd, &header, sizeof(header), 0) != sizeof(header)
+            || memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) != 0) {
+            return fail("not a snapshot index");
+        }
+        if (header.version != INDEX_VERSION || header.recordSize != sizeof(SnapshotRecord)) {
+            return fail("unsupported index version");
+        }
+        if (header.clock != static_cast<uint32_t>(clock)) return fail("recorded on a different clock");
+        // Drop a record torn by a crash mid-append
+        size_t whole = sizeof(header) + (size - sizeof(header)) / sizeof(SnapshotRecord) * sizeof(SnapshotRecord);
+        if (whole != size && ftruncate(recordsFd, whole) < 0) return fail(strerror(errno));
+    }
+
+    if (fstat(namesFd, &st) < 0) return fail(strerror(errno));
+    return shared_ptr<SnapshotIndex>(new SnapshotIndex(recordsFd, namesFd, st.st_size));
+}
+
+SnapshotIndex::SnapshotIndex(int recordsFd, int namesFd, uint64_t namesSize)
+    : recordsFd(recordsFd), namesFd(namesFd), namesSize(namesSize) {}
+
+SnapshotIndex::~SnapshotIndex() {
+    ::close(recordsFd);
+    ::close(namesFd);
+}
+
+bool SnapshotIndex::append(SnapshotRecord record, const string& fileName) {
+    lock_guard<mutex> lock(mtx);
+    if (!writeFully(namesFd, fileName.data(), fileName.size())) return false;
+    record.nameOffset = namesSize;
+    record.nameLength = static_cast<uint32_t>(fileName.size());
+    namesSize += fileName.size();
+    // O_APPEND makes this single write land whole at the end of the file
+    return writeFully(recordsFd, &record, sizeof(record));
+}
+
+SnapshotIndexView::~SnapshotIndexView() {
+    close();
+}
+
+void SnapshotIndexView::close() {
+    if (recordsMap) munmap(recordsMap, recordsLength);
+    if (namesMap) munmap(namesMap, namesLength);
+    recordsMap = namesMap = nullptr;
+    recordsLength = namesLength = 0;
+    records = nullptr;
+    count = 0;
+}
+
+// Maps a whole file read-only; an empty file maps to nothing
+static bool mapFile(const string& path, void*& data, size_t& length) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        cerr << "Cannot open " << path << ": " << strerror(errno) << endl;
+        return false;
+    }
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0;
+    length = ok ? static_cast<size_t>(st.st_size) : 0;
+    data = nullptr;
+    if (ok && length > 0) {
+        data = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            data = nullptr;
+            ok = false;
+        }
+    }
+    if (!ok) cerr << "Cannot map " << path << ": " << strerror(errno) << endl;
+    ::close(fd);
+    return ok;
+}
+
+bool SnapshotIndexView::open(const string& dir) {
+    close();
+    string recordsPath = dir + "/" + SNAPSHOT_INDEX_FILE;
+    if (!mapFile(recordsPath, recordsMap, recordsLength)) return false;
+    if (!mapFile(dir + "/" + SNAPSHOT_NAMES_FILE, namesMap, namesLength)) {
+        close();
+        return false;
+    }
+
+    const IndexHeader* header = static_cast<const IndexHeader*>(recordsMap);
+    if (recordsLength < sizeof(IndexHeader) || memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) != 0
+        || header->version != INDEX_VERSION || header->recordSize != sizeof(SnapshotRecord)) {
+        cerr << "Not a snapshot index: " << recordsPath << endl;
+        close();
+        return false;
+    }
+    records = reinterpret_cast<const SnapshotRecord*>(static_cast<const char*>(recordsMap) + sizeof(IndexHeader));
+    count = (recordsLength - sizeof(IndexHeader)) / sizeof(SnapshotRecord);
+    timeClock = header->clock == static_cast<uint32_t>(SnapshotClock::Media) ? SnapshotClock::Media
+                                                                              : SnapshotClock::Wall;
+    madvise(recordsMap, recordsLength, MADV_SEQUENTIAL);
+    return true;
+}
+
+string SnapshotIndexView::fileName(const SnapshotRecord& record) const {
+    if (record.nameOffset + record.nameLength > namesLength) return string();
+    return string(static_cast<const char*>(namesMap) + record.nameOffset, record.nameLength);
+}
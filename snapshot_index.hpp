@@ -0,0 +1,135 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 64-bit difference hash (dHash) of an image: the image is shrunk to 9x8 gray
+// and each bit records whether a pixel is darker than its right neighbour.
+// Near-identical images (same face, small shifts, lighting and JPEG noise)
+// land a few bits apart. box, if given, hashes only that region.
+uint64_t differenceHash(const cv::Mat& image, const cv::Rect& box = cv::Rect());
+
+// Number of differing bits, 0-64
+inline int hashDistance(uint64_t a, uint64_t b) {
+    return __builtin_popcountll(a ^ b);
+}
+
+struct SnapshotDedupConfig {
+    int maxDistance = 10;     // Hashes this close count as the same picture; negative = no dedup
+    int windowSeconds = 600;  // How long a captured face suppresses its near-duplicates
+};
+
+// Hashes of the most recent captures, for suppressing near-duplicates. A fixed
+// ring, so checking and adding never allocate.
+class RecentHashes {
+public:
+    // Whether hash is within maxDistance of a capture made in the last
+    // windowUs before nowUs
+    bool contains(uint64_t hash, int64_t nowUs, int maxDistance, int64_t windowUs) const;
+    void add(uint64_t hash, int64_t timeUs);
+
+private:
+    static const size_t CAPACITY = 64;
+
+    struct Entry {
+        uint64_t hash = 0;
+        int64_t timeUs = 0;
+    };
+
+    Entry entries[CAPACITY];
+    size_t count = 0;
+    size_t next = 0;
+};
+
+// One saved snapshot. Records have a fixed size and native layout, so an index
+// can be memory-mapped and used as an array.
+struct SnapshotRecord {
+    int64_t timeUs = 0;      // Capture time on the index's clock
+    uint64_t hash = 0;       // differenceHash of the face crop
+    uint64_t seq = 0;        // Frame number within the stream
+    uint64_t nameOffset = 0; // File name, as a byte range of the names file
+    int32_t trackId = 0;
+    int32_t x = 0, y = 0, width = 0, height = 0; // Face box in frame pixels
+    uint32_t nameLength = 0;
+};
+static_assert(sizeof(SnapshotRecord) == 56, "snapshot index records are a fixed 56 bytes");
+
+// What an index's timestamps count from
+enum class SnapshotClock : uint32_t {
+    Wall, // Microseconds since the Unix epoch, for live cameras
+    Media // Microseconds into the input, for offline runs
+};
+
+// File names of a snapshot directory's index: fixed-size records after a
+// short header, and the snapshot file names they point into
+static const char* const SNAPSHOT_INDEX_FILE = "index.bin";
+static const char* const SNAPSHOT_NAMES_FILE = "index.names";
+
+// Append-only writer for a snapshot directory's index. Safe to share between
+// threads. A record is appended only after its name, so a reader never sees a
+// record whose name is missing; a torn record left by a crash is cut off on
+// the next open.
+class SnapshotIndex {
+public:
+    // Opens the index in dir for appending, creating it if needed. Media-time
+    // indexes start over, since offline runs regenerate their whole directory.
+    // Returns nullptr (after logging why) if it cannot be opened, is not an
+    // index or counts time on a different clock.
+    static std::shared_ptr<SnapshotIndex> open(const std::string& dir, SnapshotClock clock);
+
+    ~SnapshotIndex();
+
+    SnapshotIndex(const SnapshotIndex&) = delete;
+    SnapshotIndex& operator=(const SnapshotIndex&) = delete;
+
+    // fileName is relative to the index's directory. Fills in the name fields.
+    bool append(SnapshotRecord record, const std::string& fileName);
+
+private:
+    SnapshotIndex(int recordsFd, int namesFd, uint64_t namesSize);
+
+    std::mutex mtx;
+    int recordsFd;
+    int namesFd;
+    uint64_t namesSize;
+};
+
+// Read-only, memory-mapped view of a snapshot index as it was when opened.
+// Records are in the order they were written, which is capture order up to
+// the reordering of a multi-threaded snapshot writer.
+class SnapshotIndexView {
+public:
+    SnapshotIndexView() = default;
+    ~SnapshotIndexView();
+
+    SnapshotIndexView(const SnapshotIndexView&) = delete;
+    SnapshotIndexView& operator=(const SnapshotIndexView&) = delete;
+
+    // False (after logging why) if dir has no readable index
+    bool open(const std::string& dir);
+
+    SnapshotClock clock() const { return timeClock; }
+    size_t size() const { return count; }
+    const SnapshotRecord& operator[](size_t i) const { return records[i]; }
+    const SnapshotRecord* begin() const { return records; }
+    const SnapshotRecord* end() const { return records + count; }
+
+    // The record's file name, relative to the directory; empty if it is out of range
+    std::string fileName(const SnapshotRecord& record) const;
+
+private:
+    void close();
+
+    void* recordsMap = nullptr;
+    size_t recordsLength = 0;
+    void* namesMap = nullptr;
+    size_t namesLength = 0;
+    const SnapshotRecord* records = nullptr;
+    size_t count = 0;
+    SnapshotClock timeClock = SnapshotClock::Wall;
+};
@@ -0,0 +1,132 @@
+#include "snapshot_writer.hpp"
+#include "kernel_log.hpp"
+#include "stage_metrics.hpp"
+#include "thread_name.hpp"
+
+#include <filesystem>
+#include <iostream>
+
+using namespace std;
+using namespace cv;
+namespace fs = std::filesystem;
+
+SnapshotWriter::SnapshotWriter(const SnapshotWriterConfig& config) : config(config) {
+    switch (config.format) {
+        case SnapshotFormat::Jpeg:
+            extension = ".jpg";
+            encodeParams = {IMWRITE_JPEG_QUALITY, config.jpegQuality};
+            break;
+        case SnapshotFormat::Png:
+            extension = ".png";
+            encodeParams = {IMWRITE_PNG_COMPRESSION, config.pngCompression};
+            break;
+        case SnapshotFormat::Webp:
+            extension = ".webp";
+            encodeParams = {IMWRITE_WEBP_QUALITY, config.webpQuality};
+            break;
+    }
+
+    int threads = config.threads > 0 ? config.threads : 1;
+    for (int i = 0; i < threads; i++) {
+        workers.emplace_back(&SnapshotWriter::workerLoop, this);
+    }
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    {
+        lock_guard<mutex> lock(mtx);
+        stopping = true;
+    }
+    notEmpty.notify_all();
+    notFull.notify_all();
+    for (auto& worker : workers) worker.join();
+}
+
+bool SnapshotWriter::submit(Mat frame, const string& basePath, bool hudLogs, shared_ptr<SnapshotIndex> index,
+                            const SnapshotRecord& record) {
+    Job job{std::move(frame), basePath + extension, hudLogs, std::move(index), record};
+    Job evicted;
+    bool evictedJob = false;
+
+    {
+        unique_lock<mutex> lock(mtx);
+        if (jobs.size() >= config.queueDepth) {
+            switch (config.dropPolicy) {
+                case SnapshotDropPolicy::Block:
+                    notFull.wait(lock, [this] { return stopping || jobs.size() < config.queueDepth; });
+                    break;
+                case SnapshotDropPolicy::DropOldest:
+                    evicted = std::move(jobs.front());
+                    jobs.pop_front();
+                    evictedJob = true;
+                    break;
+                case SnapshotDropPolicy::DropNewest:
+                    lock.unlock();
+                    job.hudLogs = false; // The caller reports rejections itself
+                    reportDrop(job);
+                    return false;
+            }
+        }
+        if (stopping) return false;
+        jobs.push_back(std::move(job));
+    }
+    notEmpty.notify_one();
+
+    if (evictedJob) reportDrop(evicted);
+    return true;
+}
+
+void SnapshotWriter::drain() {
+    unique_lock<mutex> lock(mtx);
+    idle.wait(lock, [this] { return jobs.empty() && active == 0; });
+}
+
+void SnapshotWriter::reportDrop(const Job& job) {
+    dropped++;
+    cerr << ("Snapshot dropped, writer queue full: " + job.path + "\n") << flush;
+    if (job.hudLogs) addKernelLog("Capture buffer full", 2);
+}
+
+void SnapshotWriter::workerLoop() {
+    setCurrentThreadName("snapshot");
+    while (true) {
+        Job job;
+        {
+            unique_lock<mutex> lock(mtx);
+            notEmpty.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) return; // Stopping and nothing left to write
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            active++;
+        }
+        notFull.notify_one();
+
+        bool ok = false;
+        try {
+            ScopedStageTimer timer(Stage::SnapshotWrite);
+            ok = imwrite(job.path, job.frame, encodeParams);
+        } catch (const cv::Exception& e) {
+            cerr << ("Snapshot encoder error: " + string(e.what()) + "\n") << flush;
+        }
+        job.frame.release();
+
+        if (ok) {
+            written++;
+            cout << ("Picture saved: " + job.path + "\n") << flush;
+            if (job.index && !job.index->append(job.record, fs::path(job.path).filename().string())) {
+                cerr << ("Failed to index picture: " + job.path + "\n") << flush;
+            }
+            if (job.hudLogs) addKernelLog("Image captured", 3);
+        } else {
+            failed++;
+            cerr << ("Failed to save picture: " + job.path + "\n") << flush;
+            if (job.hudLogs) addKernelLog("Failed to capture image", 3);
+        }
+
+        {
+            lock_guard<mutex> lock(mtx);
+            active--;
+            if (jobs.empty() && active == 0) idle.notify_all();
+        }
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "snapshot_index.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class SnapshotFormat { Jpeg, Png, Webp };
+
+// What submit() does when every queue slot is taken
+enum class SnapshotDropPolicy {
+    DropNewest, // Reject the incoming snapshot
+    DropOldest, // Discard the oldest queued snapshot to make room
+    Block       // Wait for a writer thread to free a slot
+};
+
+struct SnapshotWriterConfig {
+    int threads = 1;
+    size_t queueDepth = 4;
+    SnapshotDropPolicy dropPolicy = SnapshotDropPolicy::DropNewest;
+    SnapshotFormat format = SnapshotFormat::Jpeg;
+    int jpegQuality = 95;
+    int pngCompression = 3;
+    int webpQuality = 90;
+};
+
+// Background encoder pool so JPEG encoding and disk writes never run on the
+// pipeline threads. Results are reported through cout and, for HUD streams,
+// addKernelLog.
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(const SnapshotWriterConfig& config);
+    ~SnapshotWriter(); // Finishes queued snapshots before returning
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    // Queues a frame to be written to basePath plus the format's extension.
+    // The pixels are shared, not copied, so the caller must not write to the
+    // frame afterwards. Returns false if the snapshot was rejected, which is
+    // left to the caller to show on the HUD. If index is given, record is
+    // appended to it once the file has been written.
+    bool submit(cv::Mat frame, const std::string& basePath, bool hudLogs,
+                std::shared_ptr<SnapshotIndex> index = nullptr, const SnapshotRecord& record = SnapshotRecord());
+
+    // Blocks until every queued snapshot has been written
+    void drain();
+
+    uint64_t writtenCount() const { return written; }
+    uint64_t failedCount() const { return failed; }
+    uint64_t droppedCount() const { return dropped; }
+
+private:
+    struct Job {
+        cv::Mat frame;
+        std::string path;
+        bool hudLogs = false;
+        std::shared_ptr<SnapshotIndex> index;
+        SnapshotRecord record;
+    };
+
+    void workerLoop();
+    void reportDrop(const Job& job);
+
+    SnapshotWriterConfig config;
+    std::string extension;
+    std::vector<int> encodeParams;
+
+    std::mutex mtx;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::condition_variable idle;
+    std::deque<Job> jobs;
+    int active = 0;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> failed{0};
+    std::atomic<uint64_t> dropped{0};
+};
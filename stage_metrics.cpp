@@ -0,0 +1,90 @@
+#include "stage_metrics.hpp"
+
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+
+static const char* const STAGE_NAMES[] = {
+    "capture", "resize", "grayscale", "motion_gate", "detect", "tint",
+    "kernel_log", "hud_text", "show", "wait_key", "stream_encode", "snapshot_write"
+};
+static_assert(sizeof(STAGE_NAMES) / sizeof(STAGE_NAMES[0]) == static_cast<size_t>(Stage::Count),
+              "every stage needs a name");
+
+static LatencyHistogram stageHistograms[static_cast<size_t>(Stage::Count)];
+
+const char* stageName(Stage stage) {
+    return STAGE_NAMES[static_cast<size_t>(stage)];
+}
+
+LatencyHistogram& stageHistogram(Stage stage) {
+    return stageHistograms[static_cast<size_t>(stage)];
+}
+
+// Values below SUB_BUCKETS get a bucket each; above that, the leading bit picks
+// the octave and the next SUB_BUCKET_BITS bits the sub-bucket
+size_t LatencyHistogram::bucketIndex(uint64_t ns) {
+    if (ns < SUB_BUCKETS) return static_cast<size_t>(ns);
+    int exponent = 63 - __builtin_clzll(ns);
+    size_t sub = (ns >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+double LatencyHistogram::bucketMidpoint(size_t index) {
+    if (index < SUB_BUCKETS) return static_cast<double>(index);
+    int exponent = static_cast<int>(index / SUB_BUCKETS) + SUB_BUCKET_BITS - 1;
+    double width = static_cast<double>(uint64_t(1) << (exponent - SUB_BUCKET_BITS));
+    double low = (SUB_BUCKETS + index % SUB_BUCKETS) * width;
+    return low + width / 2;
+}
+
+void LatencyHistogram::record(uint64_t ns) {
+    buckets[bucketIndex(ns)].fetch_add(1, memory_order_relaxed);
+    sumNs.fetch_add(ns, memory_order_relaxed);
+    uint64_t seen = maxNs.load(memory_order_relaxed);
+    while (ns > seen && !maxNs.compare_exchange_weak(seen, ns, memory_order_relaxed)) {}
+}
+
+LatencyHistogram::Summary LatencyHistogram::summarize() const {
+    // Copy once so the percentiles agree with each other even while recording continues
+    uint64_t counts[BUCKETS];
+    Summary summary;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        counts[i] = buckets[i].load(memory_order_relaxed);
+        summary.count += counts[i];
+    }
+    summary.sumSeconds = sumNs.load(memory_order_relaxed) / 1e9;
+    summary.max = maxNs.load(memory_order_relaxed) / 1e9;
+    if (summary.count == 0) return summary;
+
+    const double quantiles[] = {0.50, 0.95, 0.99};
+    double* outputs[] = {&summary.p50, &summary.p95, &summary.p99};
+    size_t q = 0;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS && q < 3; i++) {
+        seen += counts[i];
+        while (q < 3 && seen >= quantiles[q] * summary.count) {
+            *outputs[q++] = bucketMidpoint(i) / 1e9;
+        }
+    }
+    return summary;
+}
+
+string formatStageMetrics() {
+    stringstream ss;
+    ss << "# HELP cyb_stage_latency_seconds Time spent in each pipeline stage" << endl
+       << "# TYPE cyb_stage_latency_seconds summary" << endl;
+    ss << setprecision(6);
+    for (size_t i = 0; i < static_cast<size_t>(Stage::Count); i++) {
+        Stage stage = static_cast<Stage>(i);
+        LatencyHistogram::Summary summary = stageHistogram(stage).summarize();
+        string label = string("stage=\"") + stageName(stage) + "\"";
+        ss << "cyb_stage_latency_seconds{" << label << ",quantile=\"0.5\"} " << summary.p50 << endl
+           << "cyb_stage_latency_seconds{" << label << ",quantile=\"0.95\"} " << summary.p95 << endl
+           << "cyb_stage_latency_seconds{" << label << ",quantile=\"0.99\"} " << summary.p99 << endl
+           << "cyb_stage_latency_seconds_sum{" << label << "} " << summary.sumSeconds << endl
+           << "cyb_stage_latency_seconds_count{" << label << "} " << summary.count << endl;
+    }
+    return ss.str();
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Pipeline stages with their own latency histogram
+enum class Stage {
+    Capture,       // FrameSource::read
+    Resize,        // Scaling camera frames to the working size
+    Grayscale,     // cvtColor plus the detection downscale
+    MotionGate,    // Background model update
+    Detect,        // detectMultiScale
+    Tint,          // applyTint
+    KernelLog,     // drawKernelLogs
+    HudText,       // HUD text updates and the layer blend
+    Show,          // imshow, plus the copy for HTTP viewers
+    WaitKey,       // waitKey
+    StreamEncode,  // JPEG encoding for HTTP viewers
+    SnapshotWrite, // imwrite
+    Count
+};
+
+const char* stageName(Stage stage);
+
+// Lock-free log-linear histogram of nanosecond durations, in the style of
+// HdrHistogram: every power of two is split into 16 linear sub-buckets, so any
+// recorded value is known to within about 6%. record() is a couple of relaxed
+// atomic adds and never blocks, so any thread can record while another reads.
+class LatencyHistogram {
+public:
+    struct Summary {
+        uint64_t count = 0;
+        double sumSeconds = 0.0;
+        double p50 = 0.0; // Seconds
+        double p95 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    };
+
+    void record(uint64_t ns);
+    Summary summarize() const;
+
+private:
+    static const int SUB_BUCKET_BITS = 4;
+    static const size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+    static const size_t BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    static size_t bucketIndex(uint64_t ns);
+    static double bucketMidpoint(size_t index);
+
+    std::atomic<uint64_t> buckets[BUCKETS] = {};
+    std::atomic<uint64_t> sumNs{0};
+    std::atomic<uint64_t> maxNs{0};
+};
+
+LatencyHistogram& stageHistogram(Stage stage);
+
+// Prometheus text exposition of every stage's count, sum and p50/p95/p99
+std::string formatStageMetrics();
+
+// Times the enclosing scope into a stage histogram. Build with
+// -DNO_STAGE_METRICS to compile every timer down to nothing.
+class ScopedStageTimer {
+public:
+#ifndef NO_STAGE_METRICS
+    explicit ScopedStageTimer(Stage stage) : stage(stage), start(std::chrono::steady_clock::now()) {}
+
+    ~ScopedStageTimer() {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        stageHistogram(stage).record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+
+private:
+    Stage stage;
+    std::chrono::steady_clock::time_point start;
+#else
+    explicit ScopedStageTimer(Stage) {}
+#endif
+
+public:
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+};
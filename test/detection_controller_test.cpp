@@ -0,0 +1,71 @@
+// Drives DetectionController with synthetic render and detection costs, one
+// frame at a time, detecting on every frame the current settings ask for.
+
+#include "../detection_controller.hpp"
+#include "test_util.hpp"
+
+#include <cmath>
+
+using namespace std;
+
+static const int FRAMES = 600;
+
+// Same ordering as the controller's ladder: higher runs detection more and at more detail
+static double quality(const DetectionParams& params) {
+    return params.downscale * params.downscale / (log(params.scaleFactor) * params.interval);
+}
+
+// Returns the lowest quality seen; finalQuality gets the last one
+static double run(DetectionController& controller, double renderMs, double detectMs, double& finalQuality) {
+    double lowest = quality(controller.params());
+    for (int frame = 0; frame < FRAMES; frame++) {
+        DetectionParams params = controller.params();
+        if (frame % params.interval == 0) controller.recordDetection(detectMs);
+        controller.recordRender(renderMs);
+        finalQuality = quality(controller.params());
+        if (finalQuality < lowest) lowest = finalQuality;
+    }
+    return lowest;
+}
+
+int main() {
+    DetectionControllerConfig config;
+    DetectionParams full;
+    full.interval = 1;
+    full.downscale = 1.0;
+    full.scaleFactor = 1.1;
+    double top = quality(full);
+
+    // Cheap frames, as from a 15 FPS camera on an idle machine. The frame
+    // interval is not an input, so the camera's cadence cannot read as
+    // overload: the ladder must only climb, all the way to full quality.
+    {
+        DetectionController controller(config);
+        double start = quality(controller.params());
+        double final = 0.0;
+        double lowest = run(controller, 2.0, 6.0, final);
+        check(lowest >= start, "cheap frames at 15 FPS degraded the settings");
+        check(final == top, "cheap frames at 15 FPS did not reach full quality");
+    }
+
+    // Detection that cannot keep up must still step down
+    {
+        DetectionController controller(config);
+        double start = quality(controller.params());
+        double final = 0.0;
+        run(controller, 4.0, 120.0, final);
+        check(final < start, "overloaded detection did not degrade the settings");
+    }
+
+    // Disabled, the fixed settings are used whatever is measured
+    {
+        DetectionControllerConfig fixed = config;
+        fixed.enabled = false;
+        DetectionController controller(fixed);
+        double final = 0.0;
+        run(controller, 4.0, 120.0, final);
+        check(final == quality(fixed.fixed), "a disabled controller changed the settings");
+    }
+
+    return testStatus("detection_controller_test");
+}
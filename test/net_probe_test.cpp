@@ -0,0 +1,177 @@
+#include "../event_loop.hpp"
+#include "../net_probe.hpp"
+#include "test_util.hpp"
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sched.h>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// Probes TCP targets on loopback: a listening port, a closed one and one that
+// never answers, plus the immediate re-probe on a netlink address change
+
+using namespace std;
+
+// Statuses reported on the loop thread, handed to the test thread
+struct Updates {
+    mutex mtx;
+    condition_variable arrived;
+    vector<NetStatus> seen;
+
+    void add(const NetStatus& status) {
+        {
+            lock_guard<mutex> lock(mtx);
+            seen.push_back(status);
+        }
+        arrived.notify_all();
+    }
+
+    // False if fewer than count updates arrived within the timeout
+    bool waitFor(size_t count, chrono::milliseconds timeout) {
+        unique_lock<mutex> lock(mtx);
+        return arrived.wait_for(lock, timeout, [&] { return seen.size() >= count; });
+    }
+};
+
+// A loopback socket on a free port; listens unless backlog is negative
+static int loopbackSocket(int backlog, uint16_t& port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in local = {};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(local);
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0 ||
+        (backlog >= 0 && listen(fd, backlog) < 0) ||
+        getsockname(fd, reinterpret_cast<sockaddr*>(&local), &length) < 0) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    port = ntohs(local.sin_port);
+    return fd;
+}
+
+static ProbeTarget loopbackTarget(uint16_t port) {
+    ProbeTarget target;
+    check(parseProbeTarget("127.0.0.1:" + to_string(port), target), "parse loopback target");
+    return target;
+}
+
+// Runs a prober on a loop of its own until its first status, and how long
+// that took
+static NetStatus firstStatus(const vector<ProbeTarget>& targets, int timeoutMs, double& elapsedMs) {
+    Updates updates;
+    EventLoop loop;
+    check(loop.start("probetest"), "event loop start");
+    auto started = chrono::steady_clock::now();
+    NetProbe probe(loop, targets, 10000, timeoutMs, [&](const NetStatus& status) { updates.add(status); });
+    probe.start();
+    bool arrived = updates.waitFor(1, chrono::milliseconds(timeoutMs + 5000));
+    elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+    loop.stop();
+    check(arrived, "status published");
+    return arrived ? updates.seen.front() : NetStatus();
+}
+
+// Checks in a child with a network namespace of its own, where loopback
+// starts down: bringing it up adds 127.0.0.1, and that netlink address
+// notification must re-probe at once rather than an interval later. Returns
+// false if a check failed; skips where namespaces are not allowed.
+static bool reprobesOnAddressChange(int timeoutMs) {
+    pid_t child = fork();
+    if (child < 0) return false;
+    if (child > 0) {
+        int status = 0;
+        return waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+
+    // A new user namespace grants the rights the network one needs to non-root
+    if (unshare(CLONE_NEWNET) != 0 && unshare(CLONE_NEWUSER | CLONE_NEWNET) != 0) {
+        cout << "No network namespace; netlink re-probe not checked" << endl;
+        _exit(0);
+    }
+    ProbeTarget target;
+    check(parseProbeTarget("127.0.0.1:1", target), "parse loopback target");
+
+    Updates updates;
+    EventLoop loop;
+    check(loop.start("probetest"), "event loop start");
+    NetProbe probe(loop, {target}, 60000, timeoutMs, [&](const NetStatus& status) { updates.add(status); });
+    probe.start();
+    check(updates.waitFor(1, chrono::milliseconds(timeoutMs + 5000)), "status published");
+
+    ifreq request = {};
+    strcpy(request.ifr_name, "lo");
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    bool up = fd >= 0 && ioctl(fd, SIOCGIFFLAGS, &request) == 0;
+    request.ifr_flags |= IFF_UP;
+    up = up && ioctl(fd, SIOCSIFFLAGS, &request) == 0;
+    if (fd >= 0) close(fd);
+    check(up, "bring loopback up");
+    check(updates.waitFor(2, chrono::milliseconds(timeoutMs + 5000)), "address change triggers a new round");
+    loop.stop();
+
+    check(!updates.seen.front().connected, "loopback down is unreachable");
+    check(updates.seen.back().connected, "loopback up is reachable");
+    _exit(testFailures() == 0 ? 0 : 1);
+}
+
+int main() {
+    const int timeoutMs = 300;
+    double elapsedMs = 0;
+
+    // Forks, so before any threads
+    check(reprobesOnAddressChange(timeoutMs), "netlink re-probe");
+
+    uint16_t openPort = 0;
+    int listening = loopbackSocket(SOMAXCONN, openPort);
+    check(listening >= 0, "listening socket");
+    ProbeTarget open = loopbackTarget(openPort);
+    NetStatus status = firstStatus({open}, timeoutMs, elapsedMs);
+    check(status.connected, "listening port is reachable");
+    check(status.via == open.label, "listening port reported as the route");
+    check(status.rttMs >= 0 && status.rttMs < timeoutMs, "listening port round trip measured");
+
+    // Bound but not listening, so the connect is refused
+    uint16_t closedPort = 0;
+    int bound = loopbackSocket(-1, closedPort);
+    check(bound >= 0, "bound socket");
+    status = firstStatus({loopbackTarget(closedPort)}, timeoutMs, elapsedMs);
+    check(status.connected, "refused connection counts as reachable");
+
+    // A zero backlog with one connection queued drops further SYNs, so the
+    // probe's connect never completes
+    uint16_t fullPort = 0;
+    int full = loopbackSocket(0, fullPort);
+    int queued = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in fullAddr = {};
+    fullAddr.sin_family = AF_INET;
+    fullAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    fullAddr.sin_port = htons(fullPort);
+    check(full >= 0 && queued >= 0 &&
+              connect(queued, reinterpret_cast<sockaddr*>(&fullAddr), sizeof(fullAddr)) == 0,
+          "fill the accept queue");
+    ProbeTarget silent = loopbackTarget(fullPort);
+    status = firstStatus({silent}, timeoutMs, elapsedMs);
+    check(!status.connected, "unanswered probe is unreachable");
+    check(elapsedMs >= timeoutMs - 10, "unanswered probe waits for the timeout");
+
+    // One answering target is enough, but the round still waits for the rest
+    status = firstStatus({silent, open}, timeoutMs, elapsedMs);
+    check(status.connected && status.via == open.label, "any answering target connects");
+    check(elapsedMs >= timeoutMs - 10, "round waits for its slowest probe");
+
+    for (int fd : {listening, bound, full, queued}) {
+        if (fd >= 0) close(fd);
+    }
+    return testStatus("net_probe_test");
+}
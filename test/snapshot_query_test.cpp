@@ -0,0 +1,86 @@
+// Runs the snapshot query tool over a generated live index and checks which
+// captures each time range returns.
+//
+// Usage: snapshot_query_test QUERY_TOOL
+
+#include "../snapshot_index.hpp"
+#include "test_util.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+// Local time in microseconds since the epoch
+static int64_t localUs(int year, int month, int day, int hour, int minute, int second, int micros = 0) {
+    tm local = {};
+    local.tm_year = year - 1900;
+    local.tm_mon = month - 1;
+    local.tm_mday = day;
+    local.tm_hour = hour;
+    local.tm_min = minute;
+    local.tm_sec = second;
+    local.tm_isdst = -1;
+    return static_cast<int64_t>(mktime(&local)) * 1000000 + micros;
+}
+
+// Number of matches the tool prints, or -1 if it failed
+static int countMatches(const string& tool, const string& args) {
+    FILE* out = popen((tool + " " + args + " 2>/dev/null").c_str(), "r");
+    if (!out) return -1;
+    int lines = 0;
+    char buffer[512];
+    while (fgets(buffer, sizeof(buffer), out)) lines++;
+    return pclose(out) == 0 ? lines : -1;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " QUERY_TOOL" << endl;
+        return 2;
+    }
+    string tool = argv[1];
+
+    char dirTemplate[] = "/tmp/snapshot_query_test.XXXXXX";
+    if (!mkdtemp(dirTemplate)) {
+        cerr << "Cannot create a temporary directory" << endl;
+        return 2;
+    }
+    string dir = dirTemplate;
+
+    const vector<int64_t> times = {
+        localUs(2026, 10, 15, 23, 59, 59, 999999),
+        localUs(2026, 10, 16, 0, 0, 0),
+        localUs(2026, 10, 16, 9, 30, 0, 500000),
+        localUs(2026, 10, 16, 23, 59, 59, 999999),
+        localUs(2026, 10, 17, 0, 0, 0),
+    };
+    {
+        auto index = SnapshotIndex::open(dir, SnapshotClock::Wall);
+        check(index != nullptr, "index could not be created");
+        if (!index) return testStatus("snapshot_query_test");
+        for (size_t i = 0; i < times.size(); i++) {
+            SnapshotRecord record;
+            record.timeUs = times[i];
+            record.seq = i;
+            index->append(record, "face_detected_" + to_string(i) + ".jpg");
+        }
+    }
+
+    check(countMatches(tool, dir) == 5, "no range should match everything");
+    check(countMatches(tool, "--to 2026-10-16 " + dir) == 4, "a date-only --to must cover that whole day");
+    check(countMatches(tool, "--from 2026-10-16 --to 2026-10-16 " + dir) == 3,
+          "--from and --to on the same date must match that day");
+    check(countMatches(tool, "--to '2026-10-16 09:30:00' " + dir) == 3,
+          "a --to with a time must cover that whole second");
+    check(countMatches(tool, "--to '2026-10-16 09:29:59' " + dir) == 2, "--to must stop at its second");
+    check(countMatches(tool, "--from 2026-10-17 " + dir) == 1, "a date-only --from starts at midnight");
+
+    fs::remove_all(dir);
+    return testStatus("snapshot_query_test");
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <iostream>
+
+// Minimal assertions for the self-checking tests: failures are reported and
+// counted, and main returns testStatus()
+
+inline int& testFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+inline void check(bool condition, const char* what) {
+    if (condition) return;
+    testFailures()++;
+    std::cerr << "FAILED: " << what << std::endl;
+}
+
+inline int testStatus(const char* name) {
+    if (testFailures() == 0) {
+        std::cout << name << ": ok" << std::endl;
+        return 0;
+    }
+    std::cerr << name << ": " << testFailures() << " check(s) failed" << std::endl;
+    return 1;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <pthread.h>
+#include <string>
+
+// Names the calling thread so it shows up in top, gdb and the HUD's hot-thread
+// readout. Linux caps names at 15 characters, so longer names are truncated.
+inline void setCurrentThreadName(const std::string& name) {
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+}
@@ -0,0 +1,93 @@
+#include "thread_pool.hpp"
+#include "thread_name.hpp"
+
+using namespace std;
+
+WorkStealingPool::WorkStealingPool(int threads) {
+    int count = threads > 0 ? threads : 1;
+    for (int i = 0; i < count; i++) {
+        queues.push_back(make_unique<WorkerQueue>());
+    }
+    for (int i = 0; i < count; i++) {
+        workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        lock_guard<mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) worker.join();
+}
+
+void WorkStealingPool::run(size_t count, const function<void(size_t, int)>& task) {
+    if (count == 0) return;
+
+    Batch batch;
+    batch.task = &task;
+    batch.remaining = count;
+
+    // Count the tasks before publishing them so a fast worker can never take
+    // the counter below zero
+    {
+        lock_guard<mutex> lock(sleepMutex);
+        queued += count;
+    }
+
+    // Deal the tasks out round-robin; stealing evens out whatever is left over
+    size_t start = nextQueue.fetch_add(1);
+    for (size_t i = 0; i < count; i++) {
+        WorkerQueue& queue = *queues[(start + i) % queues.size()];
+        lock_guard<mutex> lock(queue.mtx);
+        queue.tasks.push_back({&batch, i});
+    }
+    wake.notify_all();
+
+    unique_lock<mutex> lock(batch.mtx);
+    batch.done.wait(lock, [&batch] { return batch.remaining == 0; });
+}
+
+bool WorkStealingPool::popLocal(int worker, Task& task) {
+    WorkerQueue& queue = *queues[worker];
+    lock_guard<mutex> lock(queue.mtx);
+    if (queue.tasks.empty()) return false;
+    task = queue.tasks.back();
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::steal(int worker, Task& task) {
+    for (size_t offset = 1; offset < queues.size(); offset++) {
+        WorkerQueue& queue = *queues[(worker + offset) % queues.size()];
+        lock_guard<mutex> lock(queue.mtx);
+        if (queue.tasks.empty()) continue;
+        task = queue.tasks.front();
+        queue.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(int worker) {
+    setCurrentThreadName("pool-" + to_string(worker));
+    while (true) {
+        Task task;
+        if (popLocal(worker, task) || steal(worker, task)) {
+            queued--;
+            (*task.batch->task)(task.index, worker);
+
+            // Decrement under the batch lock: once run() sees zero it returns and
+            // the batch goes out of scope
+            Batch* batch = task.batch;
+            lock_guard<mutex> lock(batch->mtx);
+            if (--batch->remaining == 0) batch->done.notify_all();
+            continue;
+        }
+
+        unique_lock<mutex> lock(sleepMutex);
+        wake.wait(lock, [this] { return stopping || queued > 0; });
+        if (stopping && queued == 0) return;
+    }
+}
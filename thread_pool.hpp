@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool where each worker owns a task deque. Workers take their own
+// newest task first and steal the oldest task from a busy neighbour when idle,
+// so uneven tasks (like pyramid levels of very different sizes) balance out.
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(int threads);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    int size() const { return static_cast<int>(workers.size()); }
+
+    // Runs task(index, worker) for every index in [0, count) and returns once
+    // all of them have finished. `worker` identifies the pool thread, so tasks
+    // can use per-worker resources without locking.
+    void run(size_t count, const std::function<void(size_t index, int worker)>& task);
+
+private:
+    struct Batch {
+        const std::function<void(size_t, int)>* task;
+        std::atomic<size_t> remaining;
+        std::mutex mtx;
+        std::condition_variable done;
+    };
+
+    struct Task {
+        Batch* batch = nullptr;
+        size_t index = 0;
+    };
+
+    struct WorkerQueue {
+        std::mutex mtx;
+        std::deque<Task> tasks;
+    };
+
+    bool popLocal(int worker, Task& task);
+    bool steal(int worker, Task& task);
+    void workerLoop(int worker);
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<size_t> queued{0};
+    bool stopping = false;
+    std::atomic<size_t> nextQueue{0};
+};
@@ -0,0 +1,39 @@
+#include "tint.hpp"
+
+#include <algorithm>
+
+using namespace std;
+using namespace cv;
+
+// One 256-entry table per channel, packed as a 1x256 3-channel Mat so cv::LUT
+// can apply all three in a single vectorised pass
+static Mat buildTintTable(bool analysisMode) {
+    Mat table(1, 256, CV_8UC3);
+    Vec3b* entries = table.ptr<Vec3b>();
+    for (int i = 0; i < 256; i++) {
+        uchar half = static_cast<uchar>(i / 2);
+        uchar boost = static_cast<uchar>(min(i * 3 / 2, 255));
+        entries[i] = analysisMode ? Vec3b(boost, half, half) : Vec3b(half, half, boost);
+    }
+    return table;
+}
+
+static const Mat& tintTable(bool analysisMode) {
+    static const Mat monitoringTable = buildTintTable(false);
+    static const Mat analysisTable = buildTintTable(true);
+    return analysisMode ? analysisTable : monitoringTable;
+}
+
+void applyTint(const Mat& src, Mat& dst, bool analysisMode) {
+    LUT(src, tintTable(analysisMode), dst);
+}
+
+Scalar tintColor(const Scalar& color, bool analysisMode) {
+    const Vec3b* entries = tintTable(analysisMode).ptr<Vec3b>();
+    Scalar tinted;
+    for (int c = 0; c < 3; c++) {
+        int value = min(max(static_cast<int>(color[c]), 0), 255);
+        tinted.val[c] = entries[value][c];
+    }
+    return tinted;
+}
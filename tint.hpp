@@ -0,0 +1,12 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+// Tints a BGR frame blue (monitoring) or red (analysis) using precomputed
+// per-channel lookup tables. src and dst may be the same Mat; when they are
+// not, the tint pass doubles as the copy.
+void applyTint(const cv::Mat& src, cv::Mat& dst, bool analysisMode);
+
+// What a solid color looks like after tinting, for drawing onto a frame that
+// has already been tinted
+cv::Scalar tintColor(const cv::Scalar& color, bool analysisMode);
@@ -0,0 +1,188 @@
+// Finds snapshots through a snapshot directory's index instead of listing it.
+//
+// Usage: snapshot_query [OPTIONS] DIR
+//   --from TIME  --to TIME  Capture time range, inclusive. Live indexes take
+//                           local "YYYY-MM-DD[ HH:MM:SS]", offline ones seconds
+//                           into the input.
+//   --track ID              Only this track
+//   --like IMAGE            Snapshots whose face looks like IMAGE (ideally a
+//                           face crop), nearest first
+//   --hash HEX              The same, for a hash from an earlier query
+//   --distance BITS         Similarity cut-off for --like/--hash (default 10)
+//   --limit N               Print at most N matches
+//
+// The index is memory-mapped and scanned in place, so a query over 100k
+// snapshots takes milliseconds and touches none of the image files.
+
+#include "../snapshot_index.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+static const int DEFAULT_DISTANCE = 10;
+
+struct Query {
+    string dir;
+    string from, to;
+    int trackId = -1;
+    bool bySimilarity = false;
+    uint64_t hash = 0;
+    int maxDistance = DEFAULT_DISTANCE;
+    size_t limit = 0;
+};
+
+static void printUsage(const char* prog) {
+    cerr << "Usage: " << prog << " [--from TIME] [--to TIME] [--track ID]" << endl
+         << "         [--like IMAGE | --hash HEX] [--distance BITS] [--limit N] DIR" << endl
+         << "  TIME is local \"YYYY-MM-DD[ HH:MM:SS]\" for live indexes, seconds into the input for offline ones" << endl;
+}
+
+// Parses TIME on the index's clock into microseconds. As the end of a range,
+// local time means the last microsecond it names: the end of that second, or
+// of that day for a bare date.
+static bool parseTime(const string& text, SnapshotClock clock, bool rangeEnd, int64_t& us) {
+    if (clock == SnapshotClock::Media) {
+        char* end = nullptr;
+        double seconds = strtod(text.c_str(), &end);
+        if (end == text.c_str() || *end != '\0' || seconds < 0) return false;
+        us = static_cast<int64_t>(seconds * 1e6);
+        return true;
+    }
+    tm local = {};
+    bool dateOnly = false;
+    const char* end = strptime(text.c_str(), "%Y-%m-%d %H:%M:%S", &local);
+    if (!end) {
+        local = tm();
+        end = strptime(text.c_str(), "%Y-%m-%d", &local);
+        dateOnly = true;
+    }
+    if (!end || *end != '\0') return false;
+    // The next second or the next midnight, which mktime normalises; days
+    // with a DST change are not 24 hours long
+    if (rangeEnd) {
+        if (dateOnly) {
+            local.tm_mday++;
+        } else {
+            local.tm_sec++;
+        }
+    }
+    local.tm_isdst = -1;
+    time_t seconds = mktime(&local);
+    if (seconds == -1) return false;
+    us = static_cast<int64_t>(seconds) * 1000000 - (rangeEnd ? 1 : 0);
+    return true;
+}
+
+static string formatTime(int64_t us, SnapshotClock clock) {
+    stringstream ss;
+    if (clock == SnapshotClock::Media) {
+        ss << fixed << setprecision(3) << us / 1e6 << "s";
+    } else {
+        time_t seconds = static_cast<time_t>(us / 1000000);
+        tm local = *localtime(&seconds);
+        ss << put_time(&local, "%Y-%m-%d %H:%M:%S");
+    }
+    return ss.str();
+}
+
+static bool parseArgs(int argc, char** argv, Query& query) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--from" && i + 1 < argc) {
+            query.from = argv[++i];
+        } else if (arg == "--to" && i + 1 < argc) {
+            query.to = argv[++i];
+        } else if (arg == "--track" && i + 1 < argc) {
+            query.trackId = atoi(argv[++i]);
+        } else if (arg == "--like" && i + 1 < argc) {
+            Mat image = imread(argv[++i], IMREAD_GRAYSCALE);
+            if (image.empty()) {
+                cerr << "Cannot read " << argv[i] << endl;
+                return false;
+            }
+            query.hash = differenceHash(image);
+            query.bySimilarity = true;
+        } else if (arg == "--hash" && i + 1 < argc) {
+            char* end = nullptr;
+            query.hash = strtoull(argv[++i], &end, 16);
+            if (*end != '\0') return false;
+            query.bySimilarity = true;
+        } else if (arg == "--distance" && i + 1 < argc) {
+            query.maxDistance = atoi(argv[++i]);
+            if (query.maxDistance < 0 || query.maxDistance > 64) return false;
+        } else if (arg == "--limit" && i + 1 < argc) {
+            int limit = atoi(argv[++i]);
+            if (limit <= 0) return false;
+            query.limit = limit;
+        } else if (arg.rfind("--", 0) != 0 && query.dir.empty()) {
+            query.dir = arg;
+        } else {
+            return false;
+        }
+    }
+    return !query.dir.empty();
+}
+
+int main(int argc, char** argv) {
+    Query query;
+    if (!parseArgs(argc, argv, query)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    SnapshotIndexView index;
+    if (!index.open(query.dir)) return 1;
+
+    int64_t fromUs = numeric_limits<int64_t>::min();
+    int64_t toUs = numeric_limits<int64_t>::max();
+    if ((!query.from.empty() && !parseTime(query.from, index.clock(), false, fromUs))
+        || (!query.to.empty() && !parseTime(query.to, index.clock(), true, toUs))) {
+        cerr << "Invalid time; this index counts "
+             << (index.clock() == SnapshotClock::Media ? "seconds into the input" : "local date and time") << endl;
+        return 2;
+    }
+    auto start = chrono::steady_clock::now();
+    struct Match {
+        const SnapshotRecord* record;
+        int distance;
+    };
+    vector<Match> matches;
+    for (const SnapshotRecord& record : index) {
+        if (record.timeUs < fromUs || record.timeUs > toUs) continue;
+        if (query.trackId >= 0 && record.trackId != query.trackId) continue;
+        int distance = query.bySimilarity ? hashDistance(record.hash, query.hash) : 0;
+        if (distance > query.maxDistance) continue;
+        matches.push_back(Match{&record, distance});
+    }
+    if (query.bySimilarity) {
+        stable_sort(matches.begin(), matches.end(),
+                    [](const Match& a, const Match& b) { return a.distance < b.distance; });
+    }
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    size_t shown = query.limit > 0 ? min(query.limit, matches.size()) : matches.size();
+    for (size_t i = 0; i < shown; i++) {
+        const SnapshotRecord& record = *matches[i].record;
+        cout << left << setw(21) << formatTime(record.timeUs, index.clock()) << right << setw(8) << record.seq
+             << "  track " << setw(4) << record.trackId << "  " << record.width << "x" << record.height << "+"
+             << record.x << "+" << record.y << "  " << hex << setw(16) << setfill('0') << record.hash << dec
+             << setfill(' ');
+        if (query.bySimilarity) cout << "  d=" << setw(2) << matches[i].distance;
+        cout << "  " << index.fileName(record) << endl;
+    }
+    cerr << matches.size() << " of " << index.size() << " snapshots matched in " << fixed << setprecision(2)
+         << ms << " ms" << endl;
+    return 0;
+}
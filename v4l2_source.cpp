@@ -0,0 +1,345 @@
+#include "v4l2_source.hpp"
+#include "frame_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <linux/videodev2.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+namespace fs = std::filesystem;
+
+static const int BUFFER_COUNT = 6;
+// Luma is only lent out while the driver keeps at least this many buffers to
+// fill; past that it is copied so capture never runs dry
+static const int MIN_QUEUED_BUFFERS = 2;
+static const int CAPTURE_TIMEOUT_MS = 2000;
+static const int MAX_CORRUPT_FRAMES = 8;
+
+enum class YuvLayout {
+    Yuyv, // Packed Y0 U Y1 V
+    Nv12  // Y plane followed by interleaved UV at half resolution
+};
+
+// Decodes one frame at data into a BGR image and its luma. NV12 luma is a
+// header over data; YUYV luma is extracted into a frame pool buffer.
+static void decodeYuv(YuvLayout layout, uint8_t* data, Size size, size_t stride, Mat& bgr, LumaPlane& luma) {
+    luma = LumaPlane();
+    if (layout == YuvLayout::Nv12) {
+        Mat yuv(size.height * 3 / 2, size.width, CV_8UC1, data, stride);
+        cvtColor(yuv, bgr, COLOR_YUV2BGR_NV12);
+        luma.gray = yuv.rowRange(0, size.height);
+    } else {
+        Mat yuyv(size, CV_8UC2, data, stride);
+        cvtColor(yuyv, bgr, COLOR_YUV2BGR_YUYV);
+        attachFramePool(luma.gray);
+        extractChannel(yuyv, luma.gray, 0);
+    }
+}
+
+static int xioctl(int fd, unsigned long request, void* arg) {
+    int result;
+    do {
+        result = ioctl(fd, request, arg);
+    } while (result < 0 && errno == EINTR);
+    return result;
+}
+
+// Device and its mapped buffers. Shared with the luma keepers, so a buffer lent
+// to the detector can be queued back (and the device outlive the source) until
+// the last one returns.
+struct V4l2Device {
+    int fd = -1;
+    vector<pair<void*, size_t>> maps;
+    atomic<int> queued{0};
+    bool streaming = false;
+
+    ~V4l2Device() {
+        if (streaming) {
+            int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            xioctl(fd, VIDIOC_STREAMOFF, &type);
+        }
+        for (auto& map : maps) munmap(map.first, map.second);
+        if (fd >= 0) close(fd);
+    }
+
+    bool queue(uint32_t index) {
+        v4l2_buffer buf = {};
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = index;
+        if (xioctl(fd, VIDIOC_QBUF, &buf) < 0) return false;
+        queued++;
+        return true;
+    }
+};
+
+class V4l2Source : public FrameSource {
+public:
+    V4l2Source(string name, shared_ptr<V4l2Device> device, YuvLayout layout, Size size, size_t stride, double rate)
+        : FrameSource(std::move(name)), device(std::move(device)), layout(layout), size(size),
+          stride(stride), rate(rate) {}
+
+    bool read(Mat& frame) override {
+        LumaPlane luma;
+        return readWithLuma(frame, luma);
+    }
+
+    bool readWithLuma(Mat& frame, LumaPlane& luma) override {
+        for (int attempt = 0; attempt < MAX_CORRUPT_FRAMES; attempt++) {
+            pollfd pfd = {device->fd, POLLIN, 0};
+            int ready = poll(&pfd, 1, CAPTURE_TIMEOUT_MS);
+            if (ready < 0 && errno == EINTR) continue;
+            if (ready <= 0) {
+                cerr << name() << ": " << (ready == 0 ? "capture timed out" : strerror(errno)) << endl;
+                return false;
+            }
+
+            v4l2_buffer buf = {};
+            buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            buf.memory = V4L2_MEMORY_MMAP;
+            if (xioctl(device->fd, VIDIOC_DQBUF, &buf) < 0) {
+                if (errno == EAGAIN) continue;
+                cerr << name() << ": dequeue failed: " << strerror(errno) << endl;
+                return false;
+            }
+            device->queued--;
+            if (buf.flags & V4L2_BUF_FLAG_ERROR) {
+                device->queue(buf.index);
+                continue;
+            }
+
+            uint8_t* data = static_cast<uint8_t*>(device->maps[buf.index].first);
+            decodeYuv(layout, data, size, stride, frame, luma);
+
+            // An NV12 Y plane still points into the driver buffer: lend it, or copy
+            // it if the driver is running short, before the buffer goes back
+            if (layout == YuvLayout::Nv12 && device->queued >= MIN_QUEUED_BUFFERS) {
+                shared_ptr<V4l2Device> owner = device;
+                uint32_t index = buf.index;
+                luma.keeper = shared_ptr<void>(nullptr, [owner, index](void*) { owner->queue(index); });
+            } else {
+                if (layout == YuvLayout::Nv12) {
+                    Mat copy;
+                    attachFramePool(copy);
+                    luma.gray.copyTo(copy);
+                    luma.gray = copy;
+                }
+                if (!device->queue(buf.index)) {
+                    cerr << name() << ": requeue failed: " << strerror(errno) << endl;
+                }
+            }
+            return true;
+        }
+        cerr << name() << ": too many corrupt frames" << endl;
+        return false;
+    }
+
+    double fps() const override { return rate; }
+
+    bool isLive() const override { return true; }
+
+private:
+    shared_ptr<V4l2Device> device;
+    YuvLayout layout;
+    Size size;
+    size_t stride;
+    double rate;
+};
+
+unique_ptr<FrameSource> openV4l2Source(int index, Size size, double fps) {
+    string path = "/dev/video" + to_string(index);
+    auto device = make_shared<V4l2Device>();
+    device->fd = open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (device->fd < 0) return nullptr;
+
+    v4l2_capability caps = {};
+    if (xioctl(device->fd, VIDIOC_QUERYCAP, &caps) < 0) return nullptr;
+    uint32_t deviceCaps = (caps.capabilities & V4L2_CAP_DEVICE_CAPS) ? caps.device_caps : caps.capabilities;
+    if (!(deviceCaps & V4L2_CAP_VIDEO_CAPTURE) || !(deviceCaps & V4L2_CAP_STREAMING)) return nullptr;
+
+    // NV12 first: its Y plane can be lent to the detector without copying
+    v4l2_format format = {};
+    YuvLayout layout = YuvLayout::Nv12;
+    bool negotiated = false;
+    for (YuvLayout candidate : {YuvLayout::Nv12, YuvLayout::Yuyv}) {
+        uint32_t pixelFormat = candidate == YuvLayout::Nv12 ? V4L2_PIX_FMT_NV12 : V4L2_PIX_FMT_YUYV;
+        format = v4l2_format();
+        format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        format.fmt.pix.width = size.width;
+        format.fmt.pix.height = size.height;
+        format.fmt.pix.pixelformat = pixelFormat;
+        format.fmt.pix.field = V4L2_FIELD_NONE;
+        if (xioctl(device->fd, VIDIOC_S_FMT, &format) == 0 && format.fmt.pix.pixelformat == pixelFormat &&
+            format.fmt.pix.field == V4L2_FIELD_NONE) {
+            layout = candidate;
+            negotiated = true;
+            break;
+        }
+    }
+    if (!negotiated) {
+        cerr << path << " offers no progressive YUYV or NV12 mode; using OpenCV capture" << endl;
+        return nullptr;
+    }
+    Size actual(format.fmt.pix.width, format.fmt.pix.height);
+    size_t minStride = actual.width * (layout == YuvLayout::Yuyv ? 2 : 1);
+    size_t stride = max<size_t>(format.fmt.pix.bytesperline, minStride);
+    size_t frameBytes = layout == YuvLayout::Nv12 ? stride * actual.height * 3 / 2 : stride * actual.height;
+
+    // Frame rate is a request; drivers round it to what they support
+    v4l2_streamparm parm = {};
+    parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    parm.parm.capture.timeperframe.numerator = 1;
+    parm.parm.capture.timeperframe.denominator = static_cast<uint32_t>(fps);
+    double rate = fps;
+    if (xioctl(device->fd, VIDIOC_S_PARM, &parm) == 0 && parm.parm.capture.timeperframe.numerator > 0) {
+        rate = static_cast<double>(parm.parm.capture.timeperframe.denominator) /
+               parm.parm.capture.timeperframe.numerator;
+    }
+
+    v4l2_requestbuffers request = {};
+    request.count = BUFFER_COUNT;
+    request.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    request.memory = V4L2_MEMORY_MMAP;
+    if (xioctl(device->fd, VIDIOC_REQBUFS, &request) < 0 || request.count < 2) {
+        cerr << path << ": no mmap buffers: " << strerror(errno) << endl;
+        return nullptr;
+    }
+    for (uint32_t i = 0; i < request.count; i++) {
+        v4l2_buffer buf = {};
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = i;
+        if (xioctl(device->fd, VIDIOC_QUERYBUF, &buf) < 0) return nullptr;
+        void* map = mmap(nullptr, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, device->fd, buf.m.offset);
+        if (map == MAP_FAILED) {
+            cerr << path << ": mmap failed: " << strerror(errno) << endl;
+            return nullptr;
+        }
+        device->maps.emplace_back(map, buf.length);
+        if (buf.length < frameBytes) {
+            cerr << path << ": driver buffers are smaller than the frame" << endl;
+            return nullptr;
+        }
+    }
+    for (uint32_t i = 0; i < request.count; i++) {
+        if (!device->queue(i)) return nullptr;
+    }
+    int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (xioctl(device->fd, VIDIOC_STREAMON, &type) < 0) {
+        cerr << path << ": stream on failed: " << strerror(errno) << endl;
+        return nullptr;
+    }
+    device->streaming = true;
+
+    cout << path << ": " << (layout == YuvLayout::Nv12 ? "NV12 " : "YUYV ") << actual.width << "x"
+         << actual.height << " @ " << rate << " fps, " << request.count << " mmap buffers" << endl;
+    return make_unique<V4l2Source>("camera" + to_string(index), std::move(device), layout, actual, stride, rate);
+}
+
+// Read-only mapping of a raw file, kept alive by the luma planes lent from it
+struct FileMapping {
+    void* data = MAP_FAILED;
+    size_t length = 0;
+
+    ~FileMapping() {
+        if (data != MAP_FAILED) munmap(data, length);
+    }
+};
+
+class RawYuvSource : public FrameSource {
+public:
+    RawYuvSource(string name, shared_ptr<FileMapping> mapping, YuvLayout layout, Size size)
+        : FrameSource(std::move(name)), mapping(std::move(mapping)), layout(layout), size(size),
+          frameBytes(layout == YuvLayout::Nv12 ? size.area() * 3 / 2 : size.area() * 2) {}
+
+    bool read(Mat& frame) override {
+        LumaPlane luma;
+        return readWithLuma(frame, luma);
+    }
+
+    bool readWithLuma(Mat& frame, LumaPlane& luma) override {
+        if ((next + 1) * frameBytes > mapping->length) return false;
+        uint8_t* data = static_cast<uint8_t*>(mapping->data) + next++ * frameBytes;
+        size_t stride = layout == YuvLayout::Nv12 ? size.width : size.width * 2;
+        decodeYuv(layout, data, size, stride, frame, luma);
+        if (layout == YuvLayout::Nv12) luma.keeper = mapping;
+        return true;
+    }
+
+    double fps() const override { return 30.0; }
+
+private:
+    shared_ptr<FileMapping> mapping;
+    YuvLayout layout;
+    Size size;
+    size_t frameBytes;
+    size_t next = 0;
+};
+
+static bool rawLayout(const string& path, YuvLayout& layout) {
+    string ext = fs::path(path).extension().string();
+    transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    if (ext == ".nv12") layout = YuvLayout::Nv12;
+    else if (ext == ".yuyv") layout = YuvLayout::Yuyv;
+    else return false;
+    return true;
+}
+
+bool isRawYuvFile(const string& path) {
+    YuvLayout layout;
+    return rawLayout(path, layout);
+}
+
+unique_ptr<FrameSource> openRawYuvSource(const string& path) {
+    YuvLayout layout;
+    if (!rawLayout(path, layout)) return nullptr;
+
+    Size size(640, 480);
+    string stem = fs::path(path).stem().string();
+    size_t underscore = stem.rfind('_');
+    int width = 0, height = 0;
+    char trailing;
+    if (underscore != string::npos &&
+        sscanf(stem.c_str() + underscore + 1, "%dx%d%c", &width, &height, &trailing) == 2) {
+        size = Size(width, height);
+    }
+    if (size.width <= 0 || size.height <= 0 || size.width % 2 || size.height % 2) {
+        cerr << "Raw frame size must be even: " << path << endl;
+        return nullptr;
+    }
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        cerr << "Failed to open input: " << path << endl;
+        return nullptr;
+    }
+    struct stat info;
+    auto mapping = make_shared<FileMapping>();
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        mapping->length = static_cast<size_t>(info.st_size);
+        mapping->data = mmap(nullptr, mapping->length, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    size_t frameBytes = layout == YuvLayout::Nv12 ? size.area() * 3 / 2 : size.area() * 2;
+    if (mapping->data == MAP_FAILED || mapping->length < frameBytes) {
+        cerr << "No complete " << size.width << "x" << size.height << " frame in " << path << endl;
+        return nullptr;
+    }
+    if (mapping->length % frameBytes) {
+        cerr << "Ignoring a partial frame at the end of " << path << endl;
+    }
+    return make_unique<RawYuvSource>(inputSourceName(path), std::move(mapping), layout, size);
+}
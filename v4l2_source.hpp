@@ -0,0 +1,21 @@
+#pragma once
+
+#include "frame_source.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <memory>
+#include <string>
+
+// Camera read straight from V4L2 memory-mapped driver buffers, negotiating
+// NV12 or YUYV. Luma goes to the detector without a BGR round trip: an NV12 Y
+// plane is lent in place, a YUYV one is pulled out in a single pass. Returns
+// nullptr if the device cannot stream either format, so the caller can fall
+// back to VideoCapture.
+std::unique_ptr<FrameSource> openV4l2Source(int index, cv::Size size, double fps);
+
+// Raw frames stored back to back, as *.yuyv or *.nv12. The frame size comes
+// from a _<W>x<H> suffix on the name (clip_1280x720.nv12), else 640x480. The
+// file is mapped and decoded exactly like camera buffers, so the capture path
+// can be exercised without hardware.
+bool isRawYuvFile(const std::string& path);
+std::unique_ptr<FrameSource> openRawYuvSource(const std::string& path);